@@ -17,8 +17,10 @@
 
 #include    "bcm2835.h"
 
-#define     enable()                irq_global_enable()
-#define     disable()               irq_global_disable()
+/* Critical sections, timed when interrupt statistics are on
+ */
+#define     enable()                irq_section_exit()
+#define     disable()               irq_section_enter()
 
 /* Supported sources
  */
@@ -52,13 +54,38 @@ typedef enum
     IRQ_UART0         = 57,
 } intr_source_t;
 
+/* Interrupt service statistics of a registered handler,
+ * in ticks of the clock passed to irq_stats_start()
+ */
+typedef struct
+{
+    intr_source_t   source;
+    uint32_t        count;
+    uint32_t        latency_min;        // dispatch entry to handler call, without the dispatch monitor
+    uint32_t        latency_max;
+    uint64_t        latency_total;
+    uint32_t        service_min;        // handler run time
+    uint32_t        service_max;
+    uint64_t        service_total;
+} irq_stats_t;
+
 
 void    irq_global_enable(void);            // Global interrupt enable
 void    irq_global_disable(void);           // Global interrupt disable
+uint32_t irq_global_save(void);            // Global interrupt disable, return the previous state
+void    irq_global_restore(uint32_t state); // Restore the global interrupt state of irq_global_save()
+void    irq_section_enter(void);            // Start of a critical section, disable interrupts
+void    irq_section_exit(void);             // End of a critical section, enable interrupts
 
 void    irq_init(void);                     // Initialize the interrupt module and start services
 int     irq_register_handler(intr_source_t source, void (*handler_func)(void));
+void    irq_register_monitor(void (*monitor_func)(intr_source_t source, int done));    // Called before and after every handler
+uint32_t irq_interrupted_pc(void);         // Interrupted PC, called from an interrupt handler
 void    irq_enable(intr_source_t source);   // Enable specific interrupt source
 void    irq_disable(intr_source_t source);  // Disable specific interrupt source
 
+void    irq_stats_start(uint32_t (*clock_func)(void));             // Clear and start statistics, NULL stops them
+int     irq_stats_get(int handler, irq_stats_t *stats);             // Statistics of a handler by registration order
+void    irq_stats_masked(uint32_t *max_ticks, uint32_t *max_pc);    // Longest critical section and its enable() call
+
 #endif  /* __IRQ_H__ */
@@ -0,0 +1,75 @@
+/*
+ * pmu.h
+ *
+ *  Header file for the ARM1176JZF-S performance monitor unit.
+ *
+ *   Resources:
+ *      ARM1176JZF-S Technical Reference Manual, section 3.2.51 System Validation Counter registers
+ *      https://developer.arm.com/documentation/ddi0301/h/system-control-coprocessor/system-control-processor-registers/c15--performance-monitor-control-register--pmnc-
+ *
+ */
+
+#ifndef __PMU_H__
+#define __PMU_H__
+
+#include    <stdint.h>
+
+/* Performance monitor events for the two event counters
+ */
+typedef enum
+{
+    PMU_EVT_ICACHE_MISS    = 0x00,      // instruction cache miss
+    PMU_EVT_IFETCH_STALL   = 0x01,      // stall, instruction buffer cannot deliver
+    PMU_EVT_DATA_STALL     = 0x02,      // stall, data dependency
+    PMU_EVT_IUTLB_MISS     = 0x03,      // instruction MicroTLB miss
+    PMU_EVT_DUTLB_MISS     = 0x04,      // data MicroTLB miss
+    PMU_EVT_BRANCH         = 0x05,      // branch instruction executed
+    PMU_EVT_BRANCH_MISS    = 0x06,      // branch mispredicted
+    PMU_EVT_INSTRUCTION    = 0x07,      // instruction executed
+    PMU_EVT_DCACHE_ACCESS  = 0x09,      // data cache access, cacheable locations
+    PMU_EVT_DCACHE_ALL     = 0x0a,      // data cache access, all locations
+    PMU_EVT_DCACHE_MISS    = 0x0b,      // data cache miss
+    PMU_EVT_DCACHE_WB      = 0x0c,      // data cache write-back
+    PMU_EVT_PC_CHANGE      = 0x0d,      // software changed the PC
+    PMU_EVT_TLB_MISS       = 0x0f,      // main TLB miss
+    PMU_EVT_EXT_ACCESS     = 0x10,      // explicit external data access
+    PMU_EVT_LSU_STALL      = 0x11,      // stall, load store unit request queue full
+    PMU_EVT_WBUF_DRAIN     = 0x12,      // write buffer drained
+    PMU_EVT_CYCLES         = 0xff,      // cycle count
+} pmu_event_t;
+
+/* Counter IDs
+ */
+typedef enum
+{
+    PMU_CYCLE_COUNTER = 0,
+    PMU_COUNTER0      = 1,
+    PMU_COUNTER1      = 2,
+} pmu_counter_t;
+
+/* Counter snapshot, and counts of a measured scope
+ */
+typedef struct
+{
+    uint32_t    cycles;
+    uint32_t    count0;
+    uint32_t    count1;
+} pmu_sample_t;
+
+/* Scoped measurement, 'sample' holds the counts of
+ * the code between the two macros after PMU_SCOPE_END()
+ */
+#define     PMU_SCOPE_BEGIN(sample)     pmu_sample(&(sample))
+#define     PMU_SCOPE_END(sample)       pmu_sample_delta(&(sample))
+
+void     pmu_init(pmu_event_t event0, pmu_event_t event1);  // Select events and reset counters, counters are stopped
+void     pmu_start(void);                                   // Start counting
+void     pmu_stop(void);                                    // Stop counting
+void     pmu_reset(void);                                   // Reset all counters to 0
+uint32_t pmu_read(pmu_counter_t counter);                   // Read a counter's low 32-bit
+uint64_t pmu_read64(pmu_counter_t counter);                 // Read a counter extended to 64-bit
+void     pmu_poll(void);                                    // Account for counter overflows
+void     pmu_sample(pmu_sample_t *sample);                  // Snapshot of all counters
+void     pmu_sample_delta(pmu_sample_t *sample);            // Counts since a snapshot
+
+#endif  /* __PMU_H__ */
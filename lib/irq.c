@@ -4,6 +4,9 @@
  *  Module implementing BCM2835 and ARM interrupt management.
  *  This module is independent of the other bcm2835 IO library modules
  *  and can be used with custom IO functions.
+ *  Optional interrupt statistics time the dispatch latency and run time
+ *  of every handler, and the longest critical section, with a clock
+ *  function passed in by the application.
  *
  *  TODO Add support for (some?) FIQ interrupts.
  *
@@ -24,17 +27,24 @@
 #define     MAX_HANDLERS                8
 #define     IRQ_VEC_ADDRESS             0x00000038      // Physical address
 #define     FIQ_VEC_ADDRESS             0x0000003C      // See: start.S
+#define     IRQ_FRAME_LR                13              // saved 'lr' in the irq_handler frame, see: irq_util.S
 
 /* -----------------------------------------
    Types and data structures
 ----------------------------------------- */
 struct handler_t
 {
+    intr_source_t       source;
     uint32_t            device_irq_pend_mask;
     volatile uint32_t  *pending_reg;
     void              (*handler)(void);
 };
 
+/* -----------------------------------------
+   Module static functions
+----------------------------------------- */
+static void irq_stats_update(irq_stats_t *, uint32_t, uint32_t);
+
 /* -----------------------------------------
    Module external static functions
 ----------------------------------------- */
@@ -47,6 +57,15 @@ static  int handler_cnt = 0;
 static  interrupt_controller_regs_t *pIC = (interrupt_controller_regs_t*)BCM2835_INT_BASE;
 
 static  struct handler_t dispatch_table[MAX_HANDLERS];  // Safe, .bss section is initialized
+static  void (*dispatch_monitor)(intr_source_t, int) = 0;
+static  uint32_t *irq_frame = 0;                        // registers saved by irq_handler, while dispatching
+
+static  uint32_t (*stats_clock)(void) = 0;              // interrupt statistics time base, 0 if statistics are off
+static  irq_stats_t stats_table[MAX_HANDLERS];          // by dispatch table index
+static  int       section_open = 0;
+static  uint32_t  section_start = 0;
+static  uint32_t  section_max = 0;                      // longest critical section
+static  uint32_t  section_max_pc = 0;                   // and the address of its enable() call
 
 /*------------------------------------------------
  * irq_init()
@@ -108,6 +127,7 @@ int irq_register_handler(intr_source_t source, void (*handler_func)(void))
 
     dmb();
 
+    dispatch_table[handler_cnt].source = source;
     dispatch_table[handler_cnt].device_irq_pend_mask = (1 << shift);
     dispatch_table[handler_cnt].pending_reg = pend_reg;
     dispatch_table[handler_cnt].handler = handler_func;
@@ -117,6 +137,176 @@ int irq_register_handler(intr_source_t source, void (*handler_func)(void))
     return 1;
 }
 
+/*------------------------------------------------
+ * irq_register_monitor()
+ *
+ *  Register a function that is called before and after every
+ *  interrupt handler, for tracing and timing interrupt service.
+ *  The monitor is called in IRQ mode with the interrupt source,
+ *  and 0 before or 1 after the handler. A NULL monitor removes it.
+ *
+ * param:  Monitor function
+ * return: none
+ *
+ */
+void irq_register_monitor(void (*monitor_func)(intr_source_t source, int done))
+{
+    dispatch_monitor = monitor_func;
+}
+
+/*------------------------------------------------
+ * irq_interrupted_pc()
+ *
+ *  Address of the instruction the current interrupt will return to,
+ *  from the registers irq_handler saved on the IRQ stack.
+ *  Only valid when called from an interrupt handler.
+ *
+ * param:  none
+ * return: Interrupted PC, 0 if not called from an interrupt handler
+ *
+ */
+uint32_t irq_interrupted_pc(void)
+{
+    if ( irq_frame == 0 )
+        return 0;
+
+    return (irq_frame[IRQ_FRAME_LR] - 4);
+}
+
+/*------------------------------------------------
+ * irq_section_enter()
+ *
+ *  Start a critical section by disabling interrupts, called through disable().
+ *  When interrupt statistics are on the section is timed.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void irq_section_enter(void)
+{
+    irq_global_disable();
+
+    if ( stats_clock && !section_open )
+    {
+        section_open = 1;
+        section_start = stats_clock();
+    }
+}
+
+/*------------------------------------------------
+ * irq_section_exit()
+ *
+ *  End a critical section by enabling interrupts, called through enable().
+ *  When interrupt statistics are on the longest section is kept,
+ *  with the return address of its enable() call.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void irq_section_exit(void)
+{
+    uint32_t    time;
+
+    if ( stats_clock && section_open )
+    {
+        time = stats_clock() - section_start;
+        if ( time > section_max )
+        {
+            section_max = time;
+            section_max_pc = (uint32_t)__builtin_return_address(0);
+        }
+    }
+
+    section_open = 0;
+
+    irq_global_enable();
+}
+
+/*------------------------------------------------
+ * irq_stats_start()
+ *
+ *  Clear the interrupt statistics and start collecting them
+ *  with a free running clock, such as the System Timer or the
+ *  PMU cycle counter. Interrupt dispatch and handler times of every
+ *  registered handler, and the longest critical section are kept.
+ *
+ * param:  Clock function, NULL stops the statistics
+ * return: none
+ *
+ */
+void irq_stats_start(uint32_t (*clock_func)(void))
+{
+    int         i;
+    uint32_t    state;
+
+    state = irq_global_save();
+
+    stats_clock = 0;
+
+    for ( i = 0; i < MAX_HANDLERS; i++ )
+    {
+        stats_table[i].count = 0;
+        stats_table[i].latency_min = 0xffffffff;
+        stats_table[i].latency_max = 0;
+        stats_table[i].latency_total = 0;
+        stats_table[i].service_min = 0xffffffff;
+        stats_table[i].service_max = 0;
+        stats_table[i].service_total = 0;
+    }
+
+    section_open = 0;
+    section_max = 0;
+    section_max_pc = 0;
+
+    stats_clock = clock_func;
+
+    irq_global_restore(state);
+}
+
+/*------------------------------------------------
+ * irq_stats_get()
+ *
+ *  Get the interrupt statistics of a registered handler.
+ *  Minimum times are 0xffffffff if the handler was not called.
+ *
+ * param:  Handler index by registration order, pointer to statistics
+ * return: 1- if successful, 0- no such handler
+ *
+ */
+int irq_stats_get(int handler, irq_stats_t *stats)
+{
+    uint32_t    state;
+
+    if ( handler < 0 || handler >= handler_cnt )
+        return 0;
+
+    state = irq_global_save();
+
+        *stats = stats_table[handler];
+        stats->source = dispatch_table[handler].source;
+
+    irq_global_restore(state);
+
+    return 1;
+}
+
+/*------------------------------------------------
+ * irq_stats_masked()
+ *
+ *  Get the longest critical section between disable() and enable().
+ *
+ * param:  Pointers to section time and return address of its enable() call
+ * return: none
+ *
+ */
+void irq_stats_masked(uint32_t *max_ticks, uint32_t *max_pc)
+{
+    *max_ticks = section_max;
+    *max_pc = section_max_pc;
+}
+
 /*------------------------------------------------
  * irq_enable()
  *
@@ -194,14 +384,24 @@ void irq_disable(intr_source_t source)
  *  checks the IRQ pending bits and calls the device handler if a pending bit
  *  is set and a handler is available.
  *  Scanning is done according to user priority set by handler registration order.
+ *  With interrupt statistics on, a handler's dispatch latency is the time from
+ *  the dispatcher's start to the handler call. It includes the higher priority
+ *  handlers that ran before it in the same dispatch, and excludes the dispatch
+ *  monitor calls.
  *
- * param:  none
+ * param:  Registers saved by irq_handler
  * return: none
  *
  */
-void __irq_dispatch(void)
+void __irq_dispatch(uint32_t *frame)
 {
-    int i;
+    int         i;
+    uint32_t    entry = 0, start = 0, monitor_start = 0, monitor = 0;
+
+    irq_frame = frame;
+
+    if ( stats_clock )
+        entry = stats_clock();
 
     /* Scan the dispatch table from high to low priority
      * and call the handler if an interrupt is pending.
@@ -210,7 +410,63 @@ void __irq_dispatch(void)
     {
         if ( *(dispatch_table[i].pending_reg) & dispatch_table[i].device_irq_pend_mask )
         {
+            if ( dispatch_monitor )
+            {
+                if ( stats_clock )
+                    monitor_start = stats_clock();
+
+                dispatch_monitor(dispatch_table[i].source, 0);
+
+                if ( stats_clock )
+                    monitor += stats_clock() - monitor_start;
+            }
+
+            if ( stats_clock )
+                start = stats_clock();
+
             dispatch_table[i].handler();
+
+            if ( stats_clock )
+                irq_stats_update(&stats_table[i], start - entry - monitor, stats_clock() - start);
+
+            if ( dispatch_monitor )
+            {
+                if ( stats_clock )
+                    monitor_start = stats_clock();
+
+                dispatch_monitor(dispatch_table[i].source, 1);
+
+                if ( stats_clock )
+                    monitor += stats_clock() - monitor_start;
+            }
         }
     }
+
+    irq_frame = 0;
+}
+
+/*------------------------------------------------
+ * irq_stats_update()
+ *
+ *  Add a handler call to the handler's statistics.
+ *
+ * param:  Handler statistics, dispatch latency and handler run time
+ * return: none
+ *
+ */
+void irq_stats_update(irq_stats_t *stats, uint32_t latency, uint32_t service)
+{
+    stats->count++;
+
+    if ( latency < stats->latency_min )
+        stats->latency_min = latency;
+    if ( latency > stats->latency_max )
+        stats->latency_max = latency;
+    stats->latency_total += latency;
+
+    if ( service < stats->service_min )
+        stats->service_min = service;
+    if ( service > stats->service_max )
+        stats->service_max = service;
+    stats->service_total += service;
 }
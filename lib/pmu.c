@@ -0,0 +1,255 @@
+/*
+ * pmu.c
+ *
+ *  Module for the ARM1176JZF-S performance monitor unit (PMU).
+ *  The PMU has a 32-bit cycle counter and two 32-bit event counters,
+ *  accessed through CP15 c15 registers.
+ *
+ *  The PMU overflow interrupt (nPMUIRQ) is not routed to the BCM2835
+ *  interrupt controller, so counter overflow is handled in software:
+ *  pmu_poll() folds the PMNC overflow flags into 64-bit count extensions,
+ *  and has to be called at least once per counter wrap (about
+ *  6 seconds for the cycle counter at 700MHz).
+ *  Scoped measurements of short operations use 32-bit deltas and
+ *  do not depend on polling.
+ *
+ *   Resources:
+ *      ARM1176JZF-S Technical Reference Manual, section 3.2.51 System Validation Counter registers
+ *      https://developer.arm.com/documentation/ddi0301/h/system-control-coprocessor/system-control-processor-registers/c15--performance-monitor-control-register--pmnc-
+ *
+ */
+
+#include    "bcm2835.h"
+#include    "pmu.h"
+
+/* -----------------------------------------
+   Definitions
+----------------------------------------- */
+#define     PMNC_ENABLE         0x00000001      // enable all counters
+#define     PMNC_RESET_COUNT    0x00000002      // reset both event counters to 0
+#define     PMNC_RESET_CYCLE    0x00000004      // reset the cycle counter to 0
+#define     PMNC_CYCLE_DIV64    0x00000008      // cycle counter counts every 64th cycle
+#define     PMNC_OVF_COUNT0     0x00000100      // event counter 0 overflow flag, write 1 to clear
+#define     PMNC_OVF_COUNT1     0x00000200      // event counter 1 overflow flag
+#define     PMNC_OVF_CYCLE      0x00000400      // cycle counter overflow flag
+#define     PMNC_OVF_ALL        (PMNC_OVF_COUNT0 | PMNC_OVF_COUNT1 | PMNC_OVF_CYCLE)
+#define     PMNC_EVT1_SHIFT     12
+#define     PMNC_EVT0_SHIFT     20
+#define     PMNC_EVT_MASK       0xff
+
+#define     read_pmnc(v)        __asm__ __volatile__ ("mrc p15, 0, %0, c15, c12, 0" : "=r" (v))
+#define     write_pmnc(v)       __asm__ __volatile__ ("mcr p15, 0, %0, c15, c12, 0" : : "r" (v))
+#define     read_ccnt(v)        __asm__ __volatile__ ("mrc p15, 0, %0, c15, c12, 1" : "=r" (v))
+#define     read_cr0(v)         __asm__ __volatile__ ("mrc p15, 0, %0, c15, c12, 2" : "=r" (v))
+#define     read_cr1(v)         __asm__ __volatile__ ("mrc p15, 0, %0, c15, c12, 3" : "=r" (v))
+
+/* -----------------------------------------
+   Module globals
+----------------------------------------- */
+static uint32_t     overflow_count[3] = {0, 0, 0};     // high 32-bit of the counters, by pmu_counter_t
+
+/*------------------------------------------------
+ * pmu_init()
+ *
+ *  Select the events of the two event counters,
+ *  and reset all counters and overflow flags.
+ *  Counters are stopped until pmu_start() is called.
+ *
+ * param:  Event of counter 0, event of counter 1
+ * return: none
+ *
+ */
+void pmu_init(pmu_event_t event0, pmu_event_t event1)
+{
+    uint32_t    pmnc;
+
+    pmnc = ((event0 & PMNC_EVT_MASK) << PMNC_EVT0_SHIFT) |
+           ((event1 & PMNC_EVT_MASK) << PMNC_EVT1_SHIFT) |
+           PMNC_RESET_COUNT | PMNC_RESET_CYCLE | PMNC_OVF_ALL;
+
+    write_pmnc(pmnc);
+
+    overflow_count[PMU_CYCLE_COUNTER] = 0;
+    overflow_count[PMU_COUNTER0] = 0;
+    overflow_count[PMU_COUNTER1] = 0;
+}
+
+/*------------------------------------------------
+ * pmu_start()
+ *
+ *  Start counting.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void pmu_start(void)
+{
+    uint32_t    pmnc;
+
+    read_pmnc(pmnc);
+    pmnc &= ~(PMNC_OVF_ALL | PMNC_RESET_COUNT | PMNC_RESET_CYCLE);     // do not clear pending overflow flags
+    write_pmnc(pmnc | PMNC_ENABLE);
+}
+
+/*------------------------------------------------
+ * pmu_stop()
+ *
+ *  Stop counting, counters keep their values.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void pmu_stop(void)
+{
+    uint32_t    pmnc;
+
+    read_pmnc(pmnc);
+    pmnc &= ~(PMNC_OVF_ALL | PMNC_RESET_COUNT | PMNC_RESET_CYCLE | PMNC_ENABLE);
+    write_pmnc(pmnc);
+}
+
+/*------------------------------------------------
+ * pmu_reset()
+ *
+ *  Reset all counters and their overflow extensions to 0,
+ *  without changing the counting state.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void pmu_reset(void)
+{
+    uint32_t    pmnc;
+
+    read_pmnc(pmnc);
+    write_pmnc(pmnc | PMNC_RESET_COUNT | PMNC_RESET_CYCLE | PMNC_OVF_ALL);
+
+    overflow_count[PMU_CYCLE_COUNTER] = 0;
+    overflow_count[PMU_COUNTER0] = 0;
+    overflow_count[PMU_COUNTER1] = 0;
+}
+
+/*------------------------------------------------
+ * pmu_read()
+ *
+ *  Read a counter's 32-bit value.
+ *
+ * param:  Counter ID
+ * return: Counter value
+ *
+ */
+uint32_t pmu_read(pmu_counter_t counter)
+{
+    uint32_t    value;
+
+    if ( counter == PMU_COUNTER0 )
+        read_cr0(value);
+    else if ( counter == PMU_COUNTER1 )
+        read_cr1(value);
+    else
+        read_ccnt(value);
+
+    return value;
+}
+
+/*------------------------------------------------
+ * pmu_read64()
+ *
+ *  Read a counter extended to 64-bit with the overflows
+ *  accounted for by pmu_poll().
+ *
+ * param:  Counter ID
+ * return: Counter value
+ *
+ */
+uint64_t pmu_read64(pmu_counter_t counter)
+{
+    uint32_t    high, low;
+
+    /* Repeat if the counter wrapped between
+     * reading its high and low words
+     */
+    do
+    {
+        pmu_poll();
+        high = overflow_count[counter];
+        low = pmu_read(counter);
+        pmu_poll();
+    }
+    while ( high != overflow_count[counter] );
+
+    return (((uint64_t)high << 32) | low);
+}
+
+/*------------------------------------------------
+ * pmu_poll()
+ *
+ *  Account for counter overflows in the 64-bit extensions,
+ *  and clear the overflow flags.
+ *  Call at least once per counter wrap.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void pmu_poll(void)
+{
+    uint32_t    pmnc;
+
+    read_pmnc(pmnc);
+
+    if ( (pmnc & PMNC_OVF_ALL) == 0 )
+        return;
+
+    if ( pmnc & PMNC_OVF_CYCLE )
+        overflow_count[PMU_CYCLE_COUNTER]++;
+    if ( pmnc & PMNC_OVF_COUNT0 )
+        overflow_count[PMU_COUNTER0]++;
+    if ( pmnc & PMNC_OVF_COUNT1 )
+        overflow_count[PMU_COUNTER1]++;
+
+    /* Writing back the flags that were read clears them,
+     * and leaves flags that were set since then
+     */
+    write_pmnc(pmnc & ~(PMNC_RESET_COUNT | PMNC_RESET_CYCLE));
+}
+
+/*------------------------------------------------
+ * pmu_sample()
+ *
+ *  Take a snapshot of the three counters' 32-bit values.
+ *
+ * param:  Pointer to sample
+ * return: none
+ *
+ */
+void pmu_sample(pmu_sample_t *sample)
+{
+    read_ccnt(sample->cycles);
+    read_cr0(sample->count0);
+    read_cr1(sample->count1);
+}
+
+/*------------------------------------------------
+ * pmu_sample_delta()
+ *
+ *  Replace a snapshot with the counts since it was taken.
+ *  Valid for scopes shorter than one counter wrap.
+ *
+ * param:  Pointer to sample taken with pmu_sample()
+ * return: none
+ *
+ */
+void pmu_sample_delta(pmu_sample_t *sample)
+{
+    pmu_sample_t    now;
+
+    pmu_sample(&now);
+
+    sample->cycles = now.cycles - sample->cycles;
+    sample->count0 = now.count0 - sample->count0;
+    sample->count1 = now.count1 - sample->count1;
+}
@@ -0,0 +1,227 @@
+/*
+ * irqlat.c
+ *
+ *  Measure interrupt latency with a GPIO loopback.
+ *  The program raises a stimulus output that is wired to an input
+ *  with a rising edge detect interrupt, and the interrupt handler raises
+ *  a marker output as its first action. The time from the stimulus to
+ *  the handler is measured with the PMU cycle counter, and can be measured
+ *  externally with a scope or logic analyzer between the stimulus and
+ *  marker pins. Every fourth stimulus is raised inside a 20 uSec critical
+ *  section, to show how disabled interrupts add to the latency.
+ *  The interrupt module's statistics, dispatch latency and handler run time,
+ *  and the longest critical section, are printed with the loopback numbers.
+ *
+ *  Wiring: P1-16 (GPIO23, stimulus) to P1-18 (GPIO24, edge detect input),
+ *          P1-22 (GPIO25) is the marker output
+ *
+ *  Requires a serial terminal set to 57600,N,1
+ *
+ */
+
+#include    <stdint.h>
+
+#include    "printf.h"
+#include    "bcm2835.h"
+#include    "gpio.h"
+#include    "auxuart.h"
+#include    "irq.h"
+#include    "timer.h"
+#include    "pmu.h"
+
+/* -----------------------------------------
+   Local definitions
+----------------------------------------- */
+#define     STIMULUS        RPI_V2_GPIO_P1_16
+#define     EDGE_INPUT      RPI_V2_GPIO_P1_18
+#define     MARKER          RPI_V2_GPIO_P1_22
+
+#define     CPU_MHZ         700         // cycle counter ticks per uSec
+#define     SAMPLES         1000        // stimulus count per report
+#define     PERIOD          1000        // uSec between stimulus
+#define     MASKED_EVERY    4           // every n-th stimulus is raised in a critical section
+#define     MASKED_TIME     20          // critical section length uSec
+#define     TIMEOUT         10000       // uSec to wait for the interrupt
+
+/* -----------------------------------------
+   Module static functions
+----------------------------------------- */
+static void     edge_isr(void);
+static uint32_t cycle_clock(void);
+
+/* -----------------------------------------
+   Module globals
+----------------------------------------- */
+volatile uint32_t   isr_cycles;
+volatile int        isr_done = 0;
+
+/*------------------------------------------------
+ * kernel()
+ *
+ *  C code module entry point.
+ *
+ *  param:  ATAGs (only machine ID is valid)
+ *  return: Nothing
+ */
+void kernel(uint32_t r0, uint32_t machid, uint32_t atags)
+{
+    int         i, missed;
+    uint32_t    start, latency, min, max, total, timeout;
+    uint32_t    section_max, section_pc;
+    irq_stats_t stats;
+
+    pmu_init(PMU_EVT_CYCLES, PMU_EVT_CYCLES);
+    pmu_start();
+
+    bcm2835_gpio_fsel(STIMULUS, BCM2835_GPIO_FSEL_OUTP);
+    bcm2835_gpio_fsel(MARKER, BCM2835_GPIO_FSEL_OUTP);
+    bcm2835_gpio_fsel(EDGE_INPUT, BCM2835_GPIO_FSEL_INPT);
+    bcm2835_gpio_set_pud(EDGE_INPUT, BCM2835_GPIO_PUD_DOWN);
+    bcm2835_gpio_clr(STIMULUS);
+    bcm2835_gpio_clr(MARKER);
+
+    disable();
+
+        irq_init();
+        bcm2835_auxuart_init(BAUD_57600, 0, 0, 0);
+
+        irq_register_handler(IRQ_GPIO0, edge_isr);
+        bcm2835_gpio_clr_eds(EDGE_INPUT);
+        bcm2835_gpio_ren(EDGE_INPUT);
+        irq_enable(IRQ_GPIO0);
+
+    enable();
+
+    printf("RPi bare-metal %s %s\n", __DATE__, __TIME__ );
+    printf("GPIO loopback interrupt latency, stimulus P1-16 to input P1-18, marker P1-22\n");
+    printf("Times in uSec, every %d-th stimulus in a %d uSec critical section\n\n", MASKED_EVERY, MASKED_TIME);
+
+    while ( 1 )
+    {
+        min = 0xffffffff;
+        max = 0;
+        total = 0;
+        missed = 0;
+
+        irq_stats_start(cycle_clock);
+
+        for ( i = 0; i < SAMPLES; i++ )
+        {
+            isr_done = 0;
+
+            if ( (i % MASKED_EVERY) == 0 )
+            {
+                disable();
+                    start = cycle_clock();
+                    bcm2835_gpio_set(STIMULUS);
+                    bcm2835_st_delay(MASKED_TIME);
+                enable();
+            }
+            else
+            {
+                start = cycle_clock();
+                bcm2835_gpio_set(STIMULUS);
+            }
+
+            timeout = bcm2835_st_read();
+            while ( !isr_done && (bcm2835_st_read() - timeout) < TIMEOUT );
+
+            bcm2835_gpio_clr(STIMULUS);
+            bcm2835_gpio_clr(MARKER);
+
+            if ( isr_done )
+            {
+                latency = isr_cycles - start;
+                if ( latency < min )
+                    min = latency;
+                if ( latency > max )
+                    max = latency;
+                total += latency;
+            }
+            else
+            {
+                missed++;
+            }
+
+            bcm2835_st_delay(PERIOD);
+        }
+
+        if ( missed == SAMPLES )
+        {
+            printf("no interrupts, check the P1-16 to P1-18 loopback wire\n");
+            continue;
+        }
+
+        printf("loopback : min %4u.%02u  avg %4u.%02u  max %4u.%02u  missed %d\n",
+               min / CPU_MHZ, (min % CPU_MHZ) * 100 / CPU_MHZ,
+               (total / (SAMPLES - missed)) / CPU_MHZ, ((total / (SAMPLES - missed)) % CPU_MHZ) * 100 / CPU_MHZ,
+               max / CPU_MHZ, (max % CPU_MHZ) * 100 / CPU_MHZ,
+               missed);
+
+        if ( irq_stats_get(0, &stats) && stats.count )
+        {
+            printf("dispatch : min %4u.%02u  avg %4u.%02u  max %4u.%02u\n",
+                   stats.latency_min / CPU_MHZ, (stats.latency_min % CPU_MHZ) * 100 / CPU_MHZ,
+                   (uint32_t)(stats.latency_total / stats.count) / CPU_MHZ,
+                   ((uint32_t)(stats.latency_total / stats.count) % CPU_MHZ) * 100 / CPU_MHZ,
+                   stats.latency_max / CPU_MHZ, (stats.latency_max % CPU_MHZ) * 100 / CPU_MHZ);
+            printf("handler  : min %4u.%02u  avg %4u.%02u  max %4u.%02u\n",
+                   stats.service_min / CPU_MHZ, (stats.service_min % CPU_MHZ) * 100 / CPU_MHZ,
+                   (uint32_t)(stats.service_total / stats.count) / CPU_MHZ,
+                   ((uint32_t)(stats.service_total / stats.count) % CPU_MHZ) * 100 / CPU_MHZ,
+                   stats.service_max / CPU_MHZ, (stats.service_max % CPU_MHZ) * 100 / CPU_MHZ);
+        }
+
+        irq_stats_masked(&section_max, &section_pc);
+        printf("critical : max %4u.%02u at 0x%08x\n\n",
+               section_max / CPU_MHZ, (section_max % CPU_MHZ) * 100 / CPU_MHZ, section_pc);
+    }
+}
+
+/*------------------------------------------------
+ * edge_isr()
+ *
+ *  GPIO rising edge interrupt handler.
+ *  Raises the marker output first, for external measurement,
+ *  then records the time and clears the edge detect status.
+ *
+ *  param:  none
+ *  return: none
+ */
+void edge_isr(void)
+{
+    bcm2835_gpio_set(MARKER);
+
+    isr_cycles = cycle_clock();
+    isr_done = 1;
+
+    bcm2835_gpio_clr_eds(EDGE_INPUT);
+}
+
+/*------------------------------------------------
+ * cycle_clock()
+ *
+ *  Time base of the measurements.
+ *
+ *  param:  none
+ *  return: PMU cycle counter
+ */
+uint32_t cycle_clock(void)
+{
+    return pmu_read(PMU_CYCLE_COUNTER);
+}
+
+/*------------------------------------------------
+ * _putchar()
+ *
+ *  Low level character output/stream for printf()
+ *
+ *  param:  character
+ *  return: none
+ */
+void _putchar(char character)
+{
+    if ( character == '\n')
+        bcm2835_auxuart_putchr('\r');
+    bcm2835_auxuart_putchr(character);
+}
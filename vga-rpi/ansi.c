@@ -0,0 +1,718 @@
+/********************************************************************
+ * ansi.c
+ *
+ *  ANSI/VT100 terminal emulation on the text console.
+ *  Parses a raw terminal output stream with escape sequences and
+ *  drives the frame buffer text console. Runs of printable characters
+ *  are written with one text console call. Like a VT100, writing the
+ *  last column of a line defers the wrap to the next printable character.
+ *  The parser state is kept between packets, so an escape sequence
+ *  can be split across packets.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#include    <stdint.h>
+
+#include    "config.h"
+#include    "util.h"
+#include    "fb.h"
+#include    "ansi.h"
+
+/********************************************************************
+ * Definitions
+ *
+ */
+#define     ANSI_MAX_PARAMS     8           // CSI numeric parameters
+
+#define     ANSI_BEL            0x07
+#define     ANSI_BS             0x08
+#define     ANSI_TAB            0x09
+#define     ANSI_LF             0x0a
+#define     ANSI_VT             0x0b
+#define     ANSI_FF             0x0c
+#define     ANSI_CR             0x0d
+#define     ANSI_CAN            0x18
+#define     ANSI_SUB            0x1a
+#define     ANSI_ESC            0x1b
+#define     ANSI_DEL            0x7f
+
+#define     ANSI_TAB_STOP       8
+
+typedef enum
+{
+    ANSI_STATE_NORMAL,                      // printable text
+    ANSI_STATE_ESC,                         // ESC received
+    ANSI_STATE_CHARSET,                     // ESC ( or ESC ) received, skip the character set designator
+    ANSI_STATE_CSI,                         // ESC [ received, collecting parameters
+} ansi_state_t;
+
+/********************************************************************
+ * Static function prototypes
+ *
+ */
+static void    ansi_reset(void);
+static void    ansi_esc(uint8_t);
+static void    ansi_csi(uint8_t);
+static void    ansi_sgr(void);
+static void    ansi_erase_display(int);
+static void    ansi_erase_line(int);
+static void    ansi_reverse_index(void);
+static uint8_t ansi_attribute(void);
+static uint8_t ansi_erase_attribute(void);
+static int     ansi_param(int, int);
+
+/********************************************************************
+ * Module globals (static)
+ *
+ */
+static ansi_state_t state = ANSI_STATE_NORMAL;
+
+static int      params[ANSI_MAX_PARAMS];
+static int      param_count = 0;
+static int      param_private = 0;
+
+/* SGR (Select Graphic Rendition) state
+ * colors are ANSI color numbers 0..7
+ */
+static int      sgr_fg = 7;
+static int      sgr_bg = 0;
+static int      sgr_bright = 0;
+static int      sgr_underline = 0;
+static int      sgr_blink = 0;
+static int      sgr_reverse = 0;
+
+/* Saved cursor state for ESC 7 / ESC 8 and CSI s / CSI u
+ */
+static int      saved_column = 0;
+static int      saved_row = 0;
+static int      saved_fg = 7;
+static int      saved_bg = 0;
+static int      saved_bright = 0;
+
+/* ANSI color number to CGA color number
+ */
+static uint8_t  ansi_to_cga[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+/*------------------------------------------------
+ * ansi_emul()
+ *
+ *  Process a terminal output stream.
+ *
+ * param:  command parameters, data bytes of the stream, data byte count
+ * return: none
+ *
+ */
+void ansi_emul(cmd_param_t *cmd_param, uint8_t *data, int count)
+{
+    int         i, run_start, column, row;
+    uint8_t     c;
+
+    if ( cmd_param->cmd != UART_CMD_ANSI_OUT )
+    {
+        debug(DB_ERR, "%s: invalid command %d\n", __FUNCTION__, cmd_param->cmd);
+        return;
+    }
+
+    run_start = -1;
+
+    for ( i = 0; i < count; i++ )
+    {
+        c = data[i];
+
+        if ( state == ANSI_STATE_NORMAL )
+        {
+            /* Collect printable characters and the control characters
+             * the text console handles into one run, DEL is ignored
+             */
+            if ( (c >= 0x20 && c != ANSI_DEL) || c == ANSI_BEL || c == ANSI_BS || c == ANSI_LF || c == ANSI_CR )
+            {
+                if ( run_start == -1 )
+                    run_start = i;
+                continue;
+            }
+
+            if ( run_start != -1 )
+            {
+                fb_con_write(ansi_attribute(), ansi_erase_attribute(), &data[run_start], i - run_start, 1);
+                run_start = -1;
+            }
+
+            if ( c == ANSI_ESC )
+            {
+                state = ANSI_STATE_ESC;
+            }
+            else if ( c == ANSI_TAB )
+            {
+                fb_con_get_cursor(&column, &row);
+                fb_con_set_cursor(((column / ANSI_TAB_STOP) + 1) * ANSI_TAB_STOP, row);
+            }
+            else if ( c == ANSI_VT || c == ANSI_FF )
+            {
+                c = ANSI_LF;
+                fb_con_write(ansi_attribute(), ansi_erase_attribute(), &c, 1, 1);
+            }
+
+            continue;
+        }
+
+        /* CAN and SUB abort an escape sequence, ESC starts a new one,
+         * DEL is ignored inside a sequence too
+         */
+        if ( c == ANSI_CAN || c == ANSI_SUB )
+        {
+            state = ANSI_STATE_NORMAL;
+            continue;
+        }
+
+        if ( c == ANSI_DEL )
+            continue;
+
+        if ( c == ANSI_ESC )
+        {
+            state = ANSI_STATE_ESC;
+            continue;
+        }
+
+        switch ( state )
+        {
+            case ANSI_STATE_ESC:
+                ansi_esc(c);
+                break;
+
+            case ANSI_STATE_CHARSET:
+                state = ANSI_STATE_NORMAL;
+                break;
+
+            case ANSI_STATE_CSI:
+                ansi_csi(c);
+                break;
+
+            default:
+                state = ANSI_STATE_NORMAL;
+        }
+    }
+
+    if ( run_start != -1 )
+    {
+        fb_con_write(ansi_attribute(), ansi_erase_attribute(), &data[run_start], count - run_start, 1);
+    }
+}
+
+/*------------------------------------------------
+ * ansi_reset()
+ *
+ *  Reset terminal state, clear the page and home the cursor.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void ansi_reset(void)
+{
+    int         columns, rows, mono;
+
+    sgr_fg = 7;
+    sgr_bg = 0;
+    sgr_bright = 0;
+    sgr_underline = 0;
+    sgr_blink = 0;
+    sgr_reverse = 0;
+
+    if ( fb_con_get_info(&columns, &rows, &mono) == -1 )
+        return;
+
+    fb_con_set_region(0, rows - 1);
+    fb_con_erase(0, 0, columns - 1, rows - 1, ansi_erase_attribute());
+    fb_con_set_cursor(0, 0);
+}
+
+/*------------------------------------------------
+ * ansi_esc()
+ *
+ *  Handle the character following an ESC.
+ *
+ * param:  character
+ * return: none
+ *
+ */
+static void ansi_esc(uint8_t c)
+{
+    uint8_t     new_line[2] = { ANSI_CR, ANSI_LF };
+
+    state = ANSI_STATE_NORMAL;
+
+    switch ( c )
+    {
+        case '[':           // CSI
+            param_count = 0;
+            param_private = 0;
+            params[0] = 0;
+            state = ANSI_STATE_CSI;
+            break;
+
+        case '(':           // character set designation, only code page 437 is available
+        case ')':
+            state = ANSI_STATE_CHARSET;
+            break;
+
+        case 'c':           // RIS reset to initial state
+            ansi_reset();
+            break;
+
+        case '7':           // DECSC save cursor
+            fb_con_get_cursor(&saved_column, &saved_row);
+            saved_fg = sgr_fg;
+            saved_bg = sgr_bg;
+            saved_bright = sgr_bright;
+            break;
+
+        case '8':           // DECRC restore cursor
+            fb_con_set_cursor(saved_column, saved_row);
+            sgr_fg = saved_fg;
+            sgr_bg = saved_bg;
+            sgr_bright = saved_bright;
+            break;
+
+        case 'D':           // IND index
+            fb_con_write(ansi_attribute(), ansi_erase_attribute(), &new_line[1], 1, 1);
+            break;
+
+        case 'E':           // NEL next line
+            fb_con_write(ansi_attribute(), ansi_erase_attribute(), new_line, 2, 1);
+            break;
+
+        case 'M':           // RI reverse index
+            ansi_reverse_index();
+            break;
+
+        default:
+            debug(DB_VERBOSE, "%s: ignored ESC %c\n", __FUNCTION__, c);
+    }
+}
+
+/*------------------------------------------------
+ * ansi_csi()
+ *
+ *  Collect CSI parameters and execute the sequence on its final character.
+ *
+ * param:  character
+ * return: none
+ *
+ */
+static void ansi_csi(uint8_t c)
+{
+    int         column, row, top, bottom, n;
+    int         columns, rows, mono;
+
+    /* Parameters
+     */
+    if ( c >= '0' && c <= '9' )
+    {
+        if ( param_count == 0 )
+            param_count = 1;
+        if ( param_count <= ANSI_MAX_PARAMS && params[param_count - 1] < 10000 )
+            params[param_count - 1] = params[param_count - 1] * 10 + (c - '0');
+        return;
+    }
+
+    if ( c == ';' )
+    {
+        if ( param_count == 0 )
+            param_count = 1;
+        if ( param_count < ANSI_MAX_PARAMS )
+            params[param_count] = 0;
+        param_count++;
+        return;
+    }
+
+    if ( c == '?' )
+    {
+        param_private = 1;
+        return;
+    }
+
+    /* Intermediate characters are not used by any supported sequence
+     */
+    if ( c < 0x40 || c > 0x7e )
+        return;
+
+    /* Final character
+     */
+    state = ANSI_STATE_NORMAL;
+
+    if ( param_count > ANSI_MAX_PARAMS )
+        param_count = ANSI_MAX_PARAMS;
+
+    // private modes (cursor keys, auto wrap, cursor visibility etc.) are not supported
+    if ( param_private )
+        return;
+
+    if ( fb_con_get_info(&columns, &rows, &mono) == -1 )
+        return;
+
+    fb_con_get_cursor(&column, &row);
+    fb_con_get_region(&top, &bottom);
+
+    n = ansi_param(0, 1);
+
+    switch ( c )
+    {
+        case 'A':           // CUU cursor up
+            fb_con_set_cursor(column, row - n);
+            break;
+
+        case 'B':           // CUD cursor down
+        case 'e':           // VPR
+            fb_con_set_cursor(column, row + n);
+            break;
+
+        case 'C':           // CUF cursor forward
+        case 'a':           // HPR
+            fb_con_set_cursor(column + n, row);
+            break;
+
+        case 'D':           // CUB cursor back
+            fb_con_set_cursor(column - n, row);
+            break;
+
+        case 'E':           // CNL cursor next line
+            fb_con_set_cursor(0, row + n);
+            break;
+
+        case 'F':           // CPL cursor previous line
+            fb_con_set_cursor(0, row - n);
+            break;
+
+        case 'G':           // CHA cursor horizontal absolute
+        case '`':           // HPA
+            fb_con_set_cursor(n - 1, row);
+            break;
+
+        case 'd':           // VPA line position absolute
+            fb_con_set_cursor(column, n - 1);
+            break;
+
+        case 'H':           // CUP cursor position
+        case 'f':           // HVP
+            fb_con_set_cursor(ansi_param(1, 1) - 1, n - 1);
+            break;
+
+        case 'J':           // ED erase in display
+            ansi_erase_display(ansi_param(0, 0));
+            break;
+
+        case 'K':           // EL erase in line
+            ansi_erase_line(ansi_param(0, 0));
+            break;
+
+        case 'X':           // ECH erase characters
+            fb_con_erase(column, row, column + n - 1, row, ansi_erase_attribute());
+            break;
+
+        case 'L':           // IL insert lines
+            if ( row >= top && row <= bottom )
+                fb_con_scroll(1, row, bottom, n, ansi_erase_attribute());
+            break;
+
+        case 'M':           // DL delete lines
+            if ( row >= top && row <= bottom )
+                fb_con_scroll(0, row, bottom, n, ansi_erase_attribute());
+            break;
+
+        case 'S':           // SU scroll up
+            fb_con_scroll(0, top, bottom, n, ansi_erase_attribute());
+            break;
+
+        case 'T':           // SD scroll down
+            fb_con_scroll(1, top, bottom, n, ansi_erase_attribute());
+            break;
+
+        case 'm':           // SGR select graphic rendition
+            ansi_sgr();
+            break;
+
+        case 'r':           // DECSTBM set scroll region
+            fb_con_set_region(ansi_param(0, 1) - 1, ansi_param(1, rows) - 1);
+            fb_con_set_cursor(0, 0);
+            break;
+
+        case 's':           // SCOSC save cursor
+            saved_column = column;
+            saved_row = row;
+            break;
+
+        case 'u':           // SCORC restore cursor
+            fb_con_set_cursor(saved_column, saved_row);
+            break;
+
+        default:
+            debug(DB_VERBOSE, "%s: ignored CSI %c\n", __FUNCTION__, c);
+    }
+}
+
+/*------------------------------------------------
+ * ansi_sgr()
+ *
+ *  Select graphic rendition.
+ *  Bold selects the high intensity foreground, bright background
+ *  colors map to the normal background colors.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void ansi_sgr(void)
+{
+    int         i, p;
+
+    // no parameters is the same as a reset
+    if ( param_count == 0 )
+    {
+        params[0] = 0;
+        param_count = 1;
+    }
+
+    for ( i = 0; i < param_count; i++ )
+    {
+        p = params[i];
+
+        if ( p == 0 )
+        {
+            sgr_fg = 7;
+            sgr_bg = 0;
+            sgr_bright = 0;
+            sgr_underline = 0;
+            sgr_blink = 0;
+            sgr_reverse = 0;
+        }
+        else if ( p == 1 )
+            sgr_bright = 1;
+        else if ( p == 22 )
+            sgr_bright = 0;
+        else if ( p == 4 )
+            sgr_underline = 1;
+        else if ( p == 24 )
+            sgr_underline = 0;
+        else if ( p == 5 )
+            sgr_blink = 1;
+        else if ( p == 25 )
+            sgr_blink = 0;
+        else if ( p == 7 )
+            sgr_reverse = 1;
+        else if ( p == 27 )
+            sgr_reverse = 0;
+        else if ( p >= 30 && p <= 37 )
+            sgr_fg = p - 30;
+        else if ( p == 39 )
+            sgr_fg = 7;
+        else if ( p >= 40 && p <= 47 )
+            sgr_bg = p - 40;
+        else if ( p == 49 )
+            sgr_bg = 0;
+        else if ( p >= 90 && p <= 97 )
+        {
+            sgr_fg = p - 90;
+            sgr_bright = 1;
+        }
+        else if ( p >= 100 && p <= 107 )
+            sgr_bg = p - 100;
+    }
+}
+
+/*------------------------------------------------
+ * ansi_erase_display()
+ *
+ *  Erase in display.
+ *
+ * param:  0=cursor to end of page, 1=start of page to cursor, 2=whole page
+ * return: none
+ *
+ */
+static void ansi_erase_display(int mode)
+{
+    int         column, row, columns, rows, mono;
+    uint8_t     attribute;
+
+    if ( fb_con_get_info(&columns, &rows, &mono) == -1 )
+        return;
+
+    fb_con_get_cursor(&column, &row);
+    attribute = ansi_erase_attribute();
+
+    switch ( mode )
+    {
+        case 0:
+            fb_con_erase(column, row, columns - 1, row, attribute);
+            fb_con_erase(0, row + 1, columns - 1, rows - 1, attribute);
+            break;
+
+        case 1:
+            fb_con_erase(0, 0, columns - 1, row - 1, attribute);
+            fb_con_erase(0, row, column, row, attribute);
+            break;
+
+        case 2:
+            fb_con_erase(0, 0, columns - 1, rows - 1, attribute);
+            break;
+    }
+}
+
+/*------------------------------------------------
+ * ansi_erase_line()
+ *
+ *  Erase in line.
+ *
+ * param:  0=cursor to end of line, 1=start of line to cursor, 2=whole line
+ * return: none
+ *
+ */
+static void ansi_erase_line(int mode)
+{
+    int         column, row, columns, rows, mono;
+    uint8_t     attribute;
+
+    if ( fb_con_get_info(&columns, &rows, &mono) == -1 )
+        return;
+
+    fb_con_get_cursor(&column, &row);
+    attribute = ansi_erase_attribute();
+
+    switch ( mode )
+    {
+        case 0:
+            fb_con_erase(column, row, columns - 1, row, attribute);
+            break;
+
+        case 1:
+            fb_con_erase(0, row, column, row, attribute);
+            break;
+
+        case 2:
+            fb_con_erase(0, row, columns - 1, row, attribute);
+            break;
+    }
+}
+
+/*------------------------------------------------
+ * ansi_reverse_index()
+ *
+ *  Move the cursor up one line, and scroll the scroll region
+ *  down when the cursor is on the region's top line.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void ansi_reverse_index(void)
+{
+    int         column, row, top, bottom;
+
+    fb_con_get_cursor(&column, &row);
+    fb_con_get_region(&top, &bottom);
+
+    if ( row == top )
+    {
+        fb_con_scroll(1, top, bottom, 1, ansi_erase_attribute());
+        fb_con_set_cursor(column, row);     // cancels a deferred wrap
+    }
+    else
+        fb_con_set_cursor(column, row - 1);
+}
+
+/*------------------------------------------------
+ * ansi_attribute()
+ *
+ *  Build the text attribute byte for the current graphic rendition.
+ *  Monochrome modes only have normal, high intensity, underline,
+ *  and reverse attributes.
+ *
+ * param:  none
+ * return: attribute byte
+ *
+ */
+static uint8_t ansi_attribute(void)
+{
+    int         columns, rows, mono;
+    uint8_t     fg, bg, attribute;
+
+    fb_con_get_info(&columns, &rows, &mono);
+
+    if ( mono )
+    {
+        if ( sgr_reverse )
+            attribute = 0x70;
+        else if ( sgr_underline )
+            attribute = 0x01;
+        else
+            attribute = 0x07;
+
+        if ( sgr_bright && !sgr_reverse )
+            attribute |= 0x08;
+    }
+    else
+    {
+        fg = ansi_to_cga[sgr_fg];
+        bg = ansi_to_cga[sgr_bg];
+
+        if ( sgr_reverse )
+        {
+            attribute = fg;
+            fg = bg;
+            bg = attribute;
+        }
+
+        if ( sgr_bright )
+            fg |= 0x08;
+
+        attribute = (bg << 4) | fg;
+    }
+
+    if ( sgr_blink )
+        attribute |= FB_ATTR_BLINK;
+
+    return attribute;
+}
+
+/*------------------------------------------------
+ * ansi_erase_attribute()
+ *
+ *  Build the attribute for erased character cells,
+ *  erased cells take the current background color.
+ *
+ * param:  none
+ * return: attribute byte
+ *
+ */
+static uint8_t ansi_erase_attribute(void)
+{
+    int         columns, rows, mono;
+
+    fb_con_get_info(&columns, &rows, &mono);
+
+    if ( mono )
+        return sgr_reverse ? 0x70 : 0x07;
+
+    if ( sgr_reverse )
+        return (ansi_to_cga[sgr_fg] << 4) | 0x07;
+
+    return (ansi_to_cga[sgr_bg] << 4) | 0x07;
+}
+
+/*------------------------------------------------
+ * ansi_param()
+ *
+ *  Get a CSI parameter, missing or zero parameters take the default value.
+ *
+ * param:  parameter index, default value
+ * return: parameter value
+ *
+ */
+static int ansi_param(int index, int default_value)
+{
+    if ( index >= param_count || params[index] == 0 )
+        return default_value;
+
+    return params[index];
+}
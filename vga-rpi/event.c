@@ -0,0 +1,182 @@
+/********************************************************************
+ * event.c
+ *
+ *  Event trace of spans and instant events in a RAM ring.
+ *
+ *  Every event is two words, a time stamp and the event's phase,
+ *  ID and 16-bit payload. Spans are a begin and an end event with
+ *  the same ID. The main loop records command dispatch, idle time
+ *  and queued packets, the IRQ dispatch monitor records interrupt
+ *  handlers, and the frame buffer module records mailbox calls, which
+ *  shows where the time goes between a byte's arrival and the pixels
+ *  on the screen. When the ring is full the oldest events are
+ *  overwritten. The ring is sent on request and converted to a
+ *  Chrome trace with tools/vgaevents.py.
+ *
+ *  Event dump format, all values are 32-bit little endian:
+ *      magic 'VGAE', version, event count N, dropped event count,
+ *      time stamp ticks per uSec,
+ *      N x {time stamp, phase << 24 | ID << 16 | payload}
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#include    <stdint.h>
+
+#include    "timer.h"
+#include    "irq.h"
+#include    "pmu.h"
+
+#include    "config.h"
+#include    "uart.h"
+#include    "event.h"
+
+/********************************************************************
+ * Definitions
+ *
+ */
+#define     EVENT_RING_ENTRIES  8192        // must be a power of 2
+
+#if EVENT_CLOCK_CYCLES
+#define     EVENT_TIME()        pmu_read(PMU_CYCLE_COUNTER)
+#define     EVENT_TICKS_USEC    VGA_CPU_MHZ
+#else
+#define     EVENT_TIME()        bcm2835_st_read()
+#define     EVENT_TICKS_USEC    1
+#endif
+
+#define     EVENT_WORD(phase, id, payload)  (((phase) << 24) | ((id) << 16) | ((payload) & 0xffff))
+
+typedef struct
+{
+    uint32_t    time;
+    uint32_t    event;              // phase << 24 | ID << 16 | payload
+} event_t;
+
+/********************************************************************
+ * Static function prototypes
+ *
+ */
+#if EVENT_TRACE
+static void event_irq_monitor(intr_source_t, int);
+#endif
+
+/********************************************************************
+ * Module globals (static)
+ *
+ */
+static event_t              ring[EVENT_RING_ENTRIES];
+static volatile uint32_t    event_in = 0;           // free running event count
+static int                  event_on = 0;
+
+/*------------------------------------------------
+ * event_init()
+ *
+ *  Clear the event ring, start recording, and register
+ *  the interrupt handler monitor.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void event_init(void)
+{
+    event_in = 0;
+    event_on = EVENT_TRACE;
+
+#if EVENT_TRACE
+    irq_register_monitor(event_irq_monitor);
+#endif
+}
+
+/*------------------------------------------------
+ * event_record()
+ *
+ *  Record an event, called through the event_begin(), event_end()
+ *  and event_instant() macros. Interrupts are disabled while the event
+ *  is written and the caller's interrupt state is restored after it,
+ *  so this function can be called with interrupts disabled.
+ *
+ * param:  event phase, ID, and payload
+ * return: none
+ *
+ */
+void event_record(event_phase_t phase, event_id_t id, uint32_t payload)
+{
+    event_t    *event;
+    uint32_t    state;
+
+    if ( !event_on )
+        return;
+
+    state = irq_global_save();
+
+        event = &ring[event_in & (EVENT_RING_ENTRIES - 1)];
+        event->time = EVENT_TIME();
+        event->event = EVENT_WORD(phase, id, payload);
+        event_in++;
+
+    irq_global_restore(state);
+}
+
+/*------------------------------------------------
+ * event_send()
+ *
+ *  Send the event ring in binary and clear it.
+ *  Recording is paused while the events are sent.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void event_send(void)
+{
+    uint32_t    count, i;
+
+    event_on = 0;
+
+    count = event_in;
+    if ( count > EVENT_RING_ENTRIES )
+        count = EVENT_RING_ENTRIES;
+
+    uart_send_word(EVENT_MAGIC);
+    uart_send_word(EVENT_VERSION);
+    uart_send_word(count);
+    uart_send_word(event_in - count);
+    uart_send_word(EVENT_TICKS_USEC);
+
+    for ( i = event_in - count; i != event_in; i++ )
+    {
+        uart_send_word(ring[i & (EVENT_RING_ENTRIES - 1)].time);
+        uart_send_word(ring[i & (EVENT_RING_ENTRIES - 1)].event);
+    }
+
+    event_in = 0;
+    event_on = EVENT_TRACE;
+}
+
+#if EVENT_TRACE
+/*------------------------------------------------
+ * event_irq_monitor()
+ *
+ *  IRQ dispatch monitor that records interrupt handler spans.
+ *  Runs in IRQ mode with interrupts disabled.
+ *
+ * param:  interrupt source, 0 before the handler or 1 after it
+ * return: none
+ *
+ */
+static void event_irq_monitor(intr_source_t source, int done)
+{
+    event_t    *event;
+
+    if ( !event_on )
+        return;
+
+    event = &ring[event_in & (EVENT_RING_ENTRIES - 1)];
+    event->time = EVENT_TIME();
+    event->event = EVENT_WORD(done ? EVENT_END : EVENT_BEGIN, EVENT_IRQ, source);
+    event_in++;
+}
+#endif
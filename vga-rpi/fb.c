@@ -17,6 +17,7 @@
 #include    "fb.h"
 #include    "util.h"
 #include    "uart.h"
+#include    "event.h"
 #include    "iv8x16u.h"
 #include    "ic8x8u.h"
 //#include    "im9x14u.h"
@@ -28,18 +29,39 @@
 #define     MODE_TX             1
 #define     MODE_GR             2
 #define     MODE_NO             0           // not implemented
-#define     MAX_MODES           10
+
+#define     SCALE_FILL          0           // GPU stretches the mode to the whole display
+#define     SCALE_ASPECT        1           // GPU scales the mode to the largest 4:3 area of the display
+#define     SCALE_INTEGER       2           // GPU scales the mode by the largest whole multiple that fits the display
+#define     MAX_MODES           20
+#define     MAX_PAGES           8           // most display pages of any mode
 
 #define     FONT_UNDEF          0
 #define     FONT_8X8            1
 #define     FONT_8X16           2
 #define     FONT_9X14           3
+#define     FONT_CHARS          256
+#define     FONT_ROWS           16          // glyph rows are padded to the tallest font
 
 #define     TEXT_PAGE_MIRROR    10240       // do not change! max(160x64,40x25x8,80x25x4) uint16_t
 #define     FB_CUR_BLINK_INT    250000      // in uSec
+#define     FB_ATTR_BLINK_INT   500000      // character blink attribute, in uSec
 #define     FB_TRANSPARENT      255         // Special color definition
 #define     FB_XOR_PIXEL        0x80        // Special pixel color XOR if but 7 is set
 
+#define     FB_PAL_TEXT         0           // palette bank of the 16 CGA colors
+#define     FB_PAL_GR4          16          // palette bank of the 4 color graphics modes
+#define     FB_PAL_GR2          20          // palette bank of the 2 color graphics modes
+#define     FB_PAL_BLINK        64          // palette bank of blinking foreground colors, 8 backgrounds x 16 foregrounds
+#define     FB_PAL_BLINK_COLORS 128
+#define     FB_PAL_COLORS       (FB_PAL_BLINK + FB_PAL_BLINK_COLORS)    // palette entries in use by the banks
+#define     FB_PAL_SIZE         256         // VideoCore palette entries, all used by the DAC of mode 13h
+
+#define     VRAM_SIZE           65536       // emulated video memory window (mode 13h is the largest)
+#define     VRAM_TX_PAGE_40     11          // text page stride in video memory 2KB for 40 column modes
+#define     VRAM_TX_PAGE_80     12          // and 4KB for 80 column modes
+#define     VRAM_LINE_PIX       720         // pixels of the widest graphics mode scan line
+
 #define     FB_COMMAND          (emul_command->cmd)
 #define     FB_PAGE             (emul_command->b1)
 #define     FB_MODE             (emul_command->b1)
@@ -59,6 +81,24 @@
 #define     FB_CHAR_ATTRIB      (emul_command->b6)
 #define     FB_PIX_COL          ((emul_command->b4 << 8) + emul_command->b3)
 #define     FB_PIX_ROW          ((emul_command->b6 << 8) + emul_command->b5)
+#define     FB_MEM_OFFSET       ((emul_command->b2 << 8) + emul_command->b1)
+#define     FB_MEM_COUNT        (emul_command->b3)
+#define     FB_DRAW_COLOR       (emul_command->b2)
+#define     FB_SRC_PAGE         (emul_command->b1)
+#define     FB_DEST_PAGE        (emul_command->b2)
+#define     FB_COPY_TL_COL      (emul_command->b3)
+#define     FB_COPY_TL_ROW      (emul_command->b4)
+#define     FB_COPY_BR_COL      (emul_command->b5)
+#define     FB_COPY_BR_ROW      (emul_command->b6)
+#define     FB_DAC_INDEX        (emul_command->b1)
+#define     FB_TTY_COLOR        (emul_command->b1)
+#define     FB_FONT_FIRST       (emul_command->b1)
+#define     FB_FONT_COUNT       (emul_command->b2)
+#define     FB_FONT_POINTS      (emul_command->b3)
+#define     FB_BLK_X            ((emul_command->b2 << 8) + emul_command->b1)
+#define     FB_BLK_Y            ((emul_command->b4 << 8) + emul_command->b3)
+#define     FB_BLK_WIDTH        ((emul_command->b6 << 8) + emul_command->b5)
+#define     FB_DATA_WORD(n)     ((int16_t)(data[2*(n)] + (data[2*(n)+1] << 8)))   // signed 16-bit coordinates in command data bytes
 
 struct mode_t
 {
@@ -67,6 +107,19 @@ struct mode_t
     int mode;
     int font;
     int pages;
+    int x_pix;
+    int y_pix;
+    int scale;
+};
+
+struct vram_plane_t
+{
+    int bank_bits;      // 2^bank_bits interleaved banks of scan lines
+    int bank_shift;     // bank size is 2^bank_shift bytes
+    int bytes_per_line;
+    int lines_per_bank;
+    int bpp;            // bits per pixel 1, 2, or 8
+    int ppb_bits;       // 2^ppb_bits pixels per byte
 };
 
 struct var_info_t
@@ -81,18 +134,55 @@ struct var_info_t
  * Static function prototypes
  *
  */
+static int  fb_alloc(int, int);
+static int  fb_set_resolution(int, int);
+static void fb_get_display(void);
+static void fb_set_overscan(int, int, int);
 static void fb_cursor_on_off(int);
 static void fb_clear_screen(int);
+static void fb_clear_page(int);
+static void fb_touch_page(int);
 static void fb_clear_fbuffer_window(int, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
 static void fb_clear_tbuffer_window(int, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
 static void fb_draw_pixel(int, uint16_t, uint16_t, uint8_t);
 static void fb_draw_char(int, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, int);
+static void fb_draw_cursor_rows(int, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, int, int, int);
+static uint8_t fb_char_row_bits(uint8_t, int, uint8_t);
+static void fb_char_row_masks(uint8_t, int, uint8_t, uint32_t*);
+static void fb_font_load(uint8_t*, int, int, int);
+static void fb_font_redraw(int, int);
 static void fb_put_char(int, uint8_t, uint8_t, uint8_t, uint8_t);
 static void fb_scroll_fbuffer(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
 static void fb_scroll_tbuffer(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
 static void fb_get_char_and_attrib(uint8_t, uint8_t, uint8_t);
+static void fb_teletype(uint8_t, uint8_t*, int);
+static void fb_con_new_line(uint8_t);
 static void fb_put_pixel(int, uint8_t, uint16_t, uint16_t);
 static void fb_get_pixel(int, uint16_t, uint16_t);
+static void fb_text_colors(uint8_t, uint8_t*, uint8_t*);
+static void fb_mem_write(int, uint8_t*, int);
+static void fb_plane_write(int, uint8_t*, int);
+static void fb_dac_write(int, uint8_t*, int);
+static void fb_pix_write(int, int, int, uint8_t*, int);
+static void fb_text_mem_write(int, uint8_t*, int);
+static void fb_plane_update(int, int);
+static int  fb_plane_pixel(uint16_t, uint16_t, int*);
+static uint8_t fb_plane_set(uint16_t, uint16_t, uint8_t);
+static uint8_t fb_plane_get(uint16_t, uint16_t);
+static void fb_plane_char(uint8_t, uint8_t, uint8_t, uint8_t);
+static void fb_plane_scroll(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+static void fb_draw_line(int, uint8_t, int, int, int, int);
+static void fb_draw_rect(int, uint8_t, int, int, int, int, int);
+static void fb_draw_span(int, uint8_t, int, int, int);
+static void fb_copy_rect(int, uint8_t, int, int, int, int, int, int);
+static void fb_copy_text(int, int, int, int, int, int, int, int);
+static void fb_build_plane_luts(void);
+static void fb_build_palette_banks(void);
+static void fb_build_blink_bank(int);
+static void fb_build_vga_dac(void);
+static uint32_t fb_dac_to_bgr(uint8_t, uint8_t, uint8_t);
+static int  fb_palette_update(int, int);
+static uint32_t *fb_mailbox_process(uint32_t);
 
 /********************************************************************
  * Module globals (static)
@@ -102,15 +192,29 @@ static long int screen_size = 0;
 static int page_size = 0;
 static int active_emulation = -1;
 static int active_page = -1;
+static uint8_t page_needs_clear[MAX_PAGES]; // page is cleared on first display or write
 static uint8_t *fbp = 0;
+static int virt_x_pix = 0;                  // allocated virtual frame buffer size
+static int virt_y_pix = 0;
+static int display_x_pix = 0;               // display resolution before the first mode set, 0 if unknown
+static int display_y_pix = 0;
+static int overscan[4] = {0, 0, 0, 0};      // GPU overscan of the active mode: top, bottom, left, right
 static int  palette = 0;
 
 static struct var_info_t var_info;
 static int font_w, font_h;
-static uint8_t* font_img;
+static uint8_t* font_img;                   // built-in font of the active mode
+static uint8_t  font_ram[FONT_CHARS * FONT_ROWS];           // active font, one glyph every FONT_ROWS bytes
+static uint32_t font_atlas[FONT_CHARS * FONT_ROWS][2];      // glyph rows as byte masks of four pixels for word wide writes
 
 static uint16_t text_pages[TEXT_PAGE_MIRROR];
 
+static uint8_t  vram[VRAM_SIZE];            // video memory window shadow in native card layout
+static struct vram_plane_t *plane = 0;      // graphics mode video memory layout
+static uint8_t  plane_colors[4];            // frame buffer color of each video memory pixel value
+static uint32_t lut_1bpp[256][2];           // 1-bpp byte to 8 frame buffer pixels
+static uint32_t lut_2bpp[256];              // 2-bpp byte to 4 frame buffer pixels
+
 static int cursor_flag_show = 0;
 static int cursor_start_line = 0;
 static int cursor_end_line = 0;
@@ -119,8 +223,18 @@ static int cursor_row = 0;
 static int cursor_column = 0;
 static int cursor_row_prev = 0;
 static int cursor_column_prev = 0;
+static int cursor_drawn = 0;                // cursor rows are drawn inverted at the previous position
+static int cursor_drawn_first = 0;          // and the rows that were drawn
+static int cursor_drawn_last = 0;
+
+static int con_top_row = 0;                 // text console scroll region
+static int con_bottom_row = 0;
+static int con_wrap_pending = 0;            // last column written, wrap on the next character
 
 static uint32_t time_check;
+static uint32_t blink_time_check;
+static int      blink_in_use = 0;
+static int      blink_visible = 1;
 static mailbox_tag_property_t *mp;
 
 /*  This structure holds the graphics mode emulation parameters:
@@ -132,28 +246,60 @@ static mailbox_tag_property_t *mp;
  *   (2) mode 2 and 3 are the same, system used to turn off color for TV displays to show only B/W
  *       (example: GW-Basic's SCREEN command [colorswitch] argument)
  *   (3) modes 8 and 9 are special internal modes; 9 used for my 'new BIOS' monitor mode
+ *   (4) mode 8 text rows are truncated, 348 pixel lines do not divide into 8x8 character rows
+ *   (5) mode 19 (13h) is VGA 256 color, the frame buffer pixel is the DAC color index
+ *   (6) 'scale' selects how the GPU scales the mode's resolution to the display, the ARM only
+ *       renders the mode's resolution. SCALE_ASPECT shows the mode on a 4:3 area like a PC monitor,
+ *       SCALE_INTEGER keeps square pixels of a whole multiple size, SCALE_FILL uses the whole display
  *
- *                                     col, row, mode,    font,         pages, INT 10h,00 reg AL
+ *                                     col, row, mode,    font,         pages, x_pix, y_pix, scale,       INT 10h,00 reg AL
  */
 static struct mode_t graphics_mode[] =
 {
-        {40,  25,  MODE_TX, FONT_8X8,     8}, // 0
-        {40,  25,  MODE_TX, FONT_8X8,     8}, // 1
-        {80,  25,  MODE_TX, FONT_8X16,    4}, // 2
-        {80,  25,  MODE_TX, FONT_8X16,    4}, // 3
-        {40,  25,  MODE_GR, FONT_8X8,     1}, // 4
-        {40,  25,  MODE_GR, FONT_8X8,     1}, // 5
-        {80,  25,  MODE_GR, FONT_8X8,     1}, // 6
-        {80,  25,  MODE_TX, FONT_8X16,    1}, // 7
-                                              // ** only modes 0 to 7 are standard BIOS modes **
-        {80,  25,  MODE_NO, FONT_UNDEF,   1}, // 8 Hercules high res graphics
-        {160, 64,  MODE_TX, FONT_8X16,    1}  // 9 special mode for mon88
+        {40,  25,  MODE_TX, FONT_8X8,     8,    320,   200, SCALE_ASPECT }, // 0
+        {40,  25,  MODE_TX, FONT_8X8,     8,    320,   200, SCALE_ASPECT }, // 1
+        {80,  25,  MODE_TX, FONT_8X16,    4,    640,   400, SCALE_ASPECT }, // 2
+        {80,  25,  MODE_TX, FONT_8X16,    4,    640,   400, SCALE_ASPECT }, // 3
+        {40,  25,  MODE_GR, FONT_8X8,     1,    320,   200, SCALE_ASPECT }, // 4
+        {40,  25,  MODE_GR, FONT_8X8,     1,    320,   200, SCALE_ASPECT }, // 5
+        {80,  25,  MODE_GR, FONT_8X8,     1,    640,   200, SCALE_ASPECT }, // 6
+        {80,  25,  MODE_TX, FONT_8X16,    1,    640,   400, SCALE_ASPECT }, // 7
+                                                                           // ** only modes 0 to 7 are standard BIOS modes **
+        {90,  43,  MODE_GR, FONT_8X8,     1,    720,   348, SCALE_ASPECT }, // 8 Hercules high res graphics
+        {160, 64,  MODE_TX, FONT_8X16,    1,   1280,  1024, SCALE_INTEGER}, // 9 special mode for mon88
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 10 PCjr and EGA modes are not emulated
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 11
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 12
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 13
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 14
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 15
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 16
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 17
+        {0,   0,   MODE_NO, FONT_UNDEF,   0,      0,     0, SCALE_FILL   }, // 18
+        {40,  25,  MODE_GR, FONT_8X8,     1,    320,   200, SCALE_ASPECT }  // 19 VGA mode 13h 256 color
+};
+
+/*  Video memory layout of the graphics modes
+ *
+ *                                     bank_bits, bank_shift, bytes_per_line, lines_per_bank, bpp, ppb_bits
+ */
+static struct vram_plane_t vram_planes[] =
+{
+        {1, 13, 80,  100, 2, 2},    // CGA 320x200 4 color, modes 4 and 5
+        {1, 13, 80,  100, 1, 3},    // CGA 640x200 monochrome, mode 6
+        {2, 13, 90,   87, 1, 3},    // Hercules 720x348 monochrome, mode 8
+        {0, 16, 320, 200, 8, 0},    // VGA 320x200 256 color linear, mode 13h
 };
 
 /* Palette for 8-bpp color depth.
  * The palette is in BGR format, and 'set pixel order' does not affect
  * palette behavior.
  * Palette source: https://en.wikipedia.org/wiki/Web_colors#HTML_color_names
+ *
+ * The 16 CGA colors are copied into bank FB_PAL_TEXT of the VideoCore palette.
+ * Graphics modes draw with the indexes of their own palette bank, so that
+ * the frame buffer pixel values do not depend on the selected CGA palette,
+ * and selecting a palette only reloads the bank's palette entries.
  */
 static uint32_t cga_palette_bgr[] =
 {
@@ -175,6 +321,19 @@ static uint32_t cga_palette_bgr[] =
         0x00FFFFFF
 };
 
+static uint32_t palette_bgr[FB_PAL_SIZE];
+
+/* Byte masks of a 4-bit font pattern nibble for word wide
+ * frame buffer writes, the left most pixel (bit 3) is in the low byte.
+ */
+static const uint32_t nibble_mask[16] =
+{
+        0x00000000, 0xff000000, 0x00ff0000, 0xffff0000,
+        0x0000ff00, 0xff00ff00, 0x00ffff00, 0xffffff00,
+        0x000000ff, 0xff0000ff, 0x00ff00ff, 0xffff00ff,
+        0x0000ffff, 0xff00ffff, 0x00ffffff, 0xffffffff
+};
+
 /********************************************************************
  * fb_init()
  *
@@ -189,7 +348,8 @@ int fb_init(int emulation)
 {
     int     x_pix, y_pix;
 
-    if ( graphics_mode[emulation].mode == MODE_NO )
+    if ( emulation < 0 || emulation >= MAX_MODES ||
+         graphics_mode[emulation].mode == MODE_NO )
     {
         debug(DB_ERR, "%s: emulation type %d not supported\n", __FUNCTION__, emulation);
         return -1;
@@ -202,8 +362,8 @@ int fb_init(int emulation)
      */
     active_page = 0;
 
-    x_pix = graphics_mode[emulation].cols;
-    y_pix = graphics_mode[emulation].rows;
+    x_pix = graphics_mode[emulation].x_pix;
+    y_pix = graphics_mode[emulation].y_pix;
     if ( graphics_mode[emulation].font == FONT_8X8 )
     {
         font_w = 8;
@@ -230,17 +390,110 @@ int fb_init(int emulation)
         return -1;
     }
 
-    x_pix *= font_w;
-    y_pix *= font_h;
+    /* A mode set loads the built-in font, same as the EGA and VGA BIOS
+     */
+    fb_font_load(font_img, 0, FONT_CHARS, font_h);
+
+    /* Video memory layout and pixel expansion tables for the graphics modes
+     */
+    if ( emulation == 4 || emulation == 5 )
+        plane = &vram_planes[0];
+    else if ( emulation == 6 )
+        plane = &vram_planes[1];
+    else if ( emulation == 8 )
+        plane = &vram_planes[2];
+    else if ( emulation == 19 )
+        plane = &vram_planes[3];
+    else
+        plane = 0;
+
+    fb_build_plane_luts();
+
+    fb_build_palette_banks();
+
+    /* The GPU scales the mode's resolution to the display, the overscan
+     * borders are set in the same mailbox transaction as the resolution
+     */
+    if ( fbp == 0 && display_x_pix == 0 )
+        fb_get_display();
+
+    fb_set_overscan(x_pix, y_pix, graphics_mode[emulation].scale);
+
+    /* The frame buffer is allocated once, with a virtual size that fits the pages
+     * of all modes. A mode switch then only changes the physical display
+     * resolution and resets the virtual offset in one mailbox transaction,
+     * and follows the buffer if the firmware moved it. If the resolution change
+     * fails, the pitch changed, or the buffer is too small, allocate it again.
+     */
+    if ( fbp == 0 || fb_set_resolution(x_pix, y_pix) == -1 )
+    {
+        if ( fb_alloc(x_pix, y_pix) == -1 )
+            return -1;
+    }
+
+    page_size = var_info.pitch * y_pix;
+    var_info.xres = x_pix;
+    var_info.yres = y_pix;
+    var_info.yoffset = 0;
+
+    debug(DB_VERBOSE, "x_pix=%d, y_pix=%d, screen_size=%d, page_size=%d\n",
+                       x_pix, y_pix, screen_size, page_size);
+
+    /* Text console scroll region is the full page
+     */
+    con_top_row = 0;
+    con_bottom_row = graphics_mode[emulation].rows - 1;
+    con_wrap_pending = 0;
+
+    /* Initialize time base
+     */
+    time_check = bcm2835_st_read();
+    blink_time_check = time_check;
+    blink_in_use = 0;
+
+    return 0;
+}
+
+/*------------------------------------------------
+ * fb_alloc()
+ *
+ *  Allocate the frame buffer with a virtual size that holds
+ *  all the display pages of the largest mode, and set the physical
+ *  display resolution, overscan, color depth and palette.
+ *
+ *  param:  physical display resolution
+ *  return: 0 if no error,
+ *         -1 if error allocating
+ */
+int fb_alloc(int x_pix, int y_pix)
+{
+    int     i;
+
+    virt_x_pix = 0;
+    virt_y_pix = 0;
+    for ( i = 0; i < MAX_MODES; i++ )
+    {
+        if ( graphics_mode[i].mode == MODE_NO )
+            continue;
+
+        if ( graphics_mode[i].x_pix > virt_x_pix )
+            virt_x_pix = graphics_mode[i].x_pix;
+
+        if ( (graphics_mode[i].y_pix * graphics_mode[i].pages) > virt_y_pix )
+            virt_y_pix = graphics_mode[i].y_pix * graphics_mode[i].pages;
+    }
+
+    fbp = 0;
 
     bcm2835_mailbox_init();
     bcm2835_mailbox_add_tag(TAG_FB_ALLOCATE, 4);
     bcm2835_mailbox_add_tag(TAG_FB_SET_PHYS_DISPLAY, x_pix, y_pix);
-    bcm2835_mailbox_add_tag(TAG_FB_SET_VIRT_DISPLAY, x_pix, (y_pix * graphics_mode[emulation].pages));
+    bcm2835_mailbox_add_tag(TAG_FB_SET_VIRT_DISPLAY, virt_x_pix, virt_y_pix);
+    bcm2835_mailbox_add_tag(TAG_FB_SET_OVERSCAN, overscan[0], overscan[1], overscan[2], overscan[3]);
     bcm2835_mailbox_add_tag(TAG_FB_SET_DEPTH, 8);
-    bcm2835_mailbox_add_tag(TAG_FB_SET_PALETTE, 0, 16, (uint32_t)cga_palette_bgr);
+    bcm2835_mailbox_add_tag(TAG_FB_SET_PALETTE, 0, FB_PAL_SIZE, (uint32_t)(uintptr_t)palette_bgr);
     bcm2835_mailbox_add_tag(TAG_FB_GET_PITCH);
-    if ( !bcm2835_mailbox_process() )
+    if ( !fb_mailbox_process(TAG_FB_ALLOCATE) )
     {
         debug(DB_ERR, "%s: bcm2835_mailbox_process() failed\n", __FUNCTION__);
         return -1;
@@ -252,7 +505,7 @@ int fb_init(int emulation)
     if ( mp )
     {
         screen_size = mp->values.fb_alloc.param2;
-        fbp = (uint8_t*)(mp->values.fb_alloc.param1);
+        fbp = (uint8_t*)(uintptr_t)mp->values.fb_alloc.param1;
     }
     else
     {
@@ -261,18 +514,12 @@ int fb_init(int emulation)
     }
 
     mp = bcm2835_mailbox_get_property(TAG_FB_SET_PHYS_DISPLAY);
-    if ( mp &&
-         mp->values.fb_set.param1 == x_pix &&
-         mp->values.fb_set.param2 == y_pix )
-    {
-        page_size = x_pix * y_pix;
-        var_info.xres = x_pix;
-        var_info.yres = y_pix;
-        var_info.yoffset = 0;
-    }
-    else
+    if ( !mp ||
+         mp->values.fb_set.param1 != (uint32_t)x_pix ||
+         mp->values.fb_set.param2 != (uint32_t)y_pix )
     {
         debug(DB_ERR, "%s: TAG_FB_SET_PHYS_DISPLAY failed\n", __FUNCTION__);
+        fbp = 0;
         return -1;
     }
 
@@ -284,32 +531,169 @@ int fb_init(int emulation)
     else
     {
         debug(DB_ERR, "%s: TAG_FB_GET_PITCH failed\n", __FUNCTION__);
+        fbp = 0;
         return -1;
     }
 
-    debug(DB_VERBOSE, "x_pix=%d, y_pix=%d, screen_size=%d, page_size=%d\n",
-                       x_pix, y_pix, screen_size, page_size);
+    return 0;
+}
 
-    /* Initialize time base
+/*------------------------------------------------
+ * fb_set_resolution()
+ *
+ *  Change the physical display resolution and overscan inside the allocated
+ *  virtual frame buffer, show the first page, and reload the palette.
+ *  This is one mailbox transaction, which also reads back the frame buffer
+ *  address and size in case the firmware moved the buffer.
+ *
+ *  param:  physical display resolution
+ *  return: 0 if no error,
+ *         -1 if the frame buffer needs to be allocated again
+ */
+int fb_set_resolution(int x_pix, int y_pix)
+{
+    bcm2835_mailbox_init();
+    bcm2835_mailbox_add_tag(TAG_FB_SET_PHYS_DISPLAY, x_pix, y_pix);
+    bcm2835_mailbox_add_tag(TAG_FB_SET_VIRT_OFFSET, 0, 0);
+    bcm2835_mailbox_add_tag(TAG_FB_SET_OVERSCAN, overscan[0], overscan[1], overscan[2], overscan[3]);
+    bcm2835_mailbox_add_tag(TAG_FB_SET_PALETTE, 0, FB_PAL_SIZE, (uint32_t)(uintptr_t)palette_bgr);
+    bcm2835_mailbox_add_tag(TAG_FB_GET_PITCH);
+    bcm2835_mailbox_add_tag(TAG_FB_ALLOCATE, 4);
+    if ( !fb_mailbox_process(TAG_FB_SET_PHYS_DISPLAY) )
+    {
+        debug(DB_ERR, "%s: bcm2835_mailbox_process() failed\n", __FUNCTION__);
+        return -1;
+    }
+
+    mp = bcm2835_mailbox_get_property(TAG_FB_SET_PHYS_DISPLAY);
+    if ( !mp ||
+         mp->values.fb_set.param1 != (uint32_t)x_pix ||
+         mp->values.fb_set.param2 != (uint32_t)y_pix )
+    {
+        debug(DB_ERR, "%s: TAG_FB_SET_PHYS_DISPLAY failed\n", __FUNCTION__);
+        return -1;
+    }
+
+    mp = bcm2835_mailbox_get_property(TAG_FB_GET_PITCH);
+    if ( !mp || mp->values.fb_get.param1 != (uint32_t)var_info.pitch )
+    {
+        debug(DB_ERR, "%s: frame buffer pitch changed\n", __FUNCTION__);
+        return -1;
+    }
+
+    /* Follow the buffer if the firmware moved it, the display pages
+     * are cleared after a mode set so its content does not matter
      */
-    time_check = bcm2835_st_read();
+    mp = bcm2835_mailbox_get_property(TAG_FB_ALLOCATE);
+    if ( !mp || mp->values.fb_alloc.param1 == 0 ||
+         mp->values.fb_alloc.param2 < (uint32_t)(var_info.pitch * virt_y_pix) )
+    {
+        debug(DB_ERR, "%s: TAG_FB_ALLOCATE failed\n", __FUNCTION__);
+        return -1;
+    }
+
+    if ( (uint8_t*)(uintptr_t)mp->values.fb_alloc.param1 != fbp ||
+         (long int)mp->values.fb_alloc.param2 != screen_size )
+    {
+        debug(DB_INFO, "%s: frame buffer moved\n", __FUNCTION__);
+        fbp = (uint8_t*)(uintptr_t)mp->values.fb_alloc.param1;
+        screen_size = mp->values.fb_alloc.param2;
+    }
 
     return 0;
 }
 
+/*------------------------------------------------
+ * fb_get_display()
+ *
+ *  Get the display resolution the firmware set up at boot,
+ *  before the first mode set changes the physical display size.
+ *
+ *  param:  none
+ *  return: none, display size is 0 if unknown
+ */
+void fb_get_display(void)
+{
+    display_x_pix = 0;
+    display_y_pix = 0;
+
+    bcm2835_mailbox_init();
+    bcm2835_mailbox_add_tag(TAG_FB_GET_PHYS_DISPLAY);
+    if ( !fb_mailbox_process(TAG_FB_GET_PHYS_DISPLAY) )
+    {
+        debug(DB_ERR, "%s: bcm2835_mailbox_process() failed\n", __FUNCTION__);
+        return;
+    }
+
+    mp = bcm2835_mailbox_get_property(TAG_FB_GET_PHYS_DISPLAY);
+    if ( mp )
+    {
+        display_x_pix = mp->values.fb_get.param1;
+        display_y_pix = mp->values.fb_get.param2;
+    }
+
+    debug(DB_INFO, "%s: display %dx%d\n", __FUNCTION__, display_x_pix, display_y_pix);
+}
+
+/*------------------------------------------------
+ * fb_set_overscan()
+ *
+ *  Calculate the overscan borders, in display pixels, that place
+ *  the scaled mode resolution in the center of the display.
+ *  The borders are 0 and the GPU fills the display when the
+ *  display resolution is unknown or the mode does not fit.
+ *
+ *  param:  mode resolution, scaling method
+ *  return: none
+ */
+void fb_set_overscan(int x_pix, int y_pix, int scale)
+{
+    int     area_x, area_y, factor;
+
+    area_x = display_x_pix;
+    area_y = display_y_pix;
+
+    if ( scale == SCALE_ASPECT )
+    {
+        if ( (display_x_pix * 3) > (display_y_pix * 4) )
+            area_x = (display_y_pix * 4) / 3;
+        else
+            area_y = (display_x_pix * 3) / 4;
+    }
+    else if ( scale == SCALE_INTEGER && x_pix > 0 && y_pix > 0 )
+    {
+        factor = display_x_pix / x_pix;
+        if ( (display_y_pix / y_pix) < factor )
+            factor = display_y_pix / y_pix;
+
+        if ( factor > 0 )
+        {
+            area_x = x_pix * factor;
+            area_y = y_pix * factor;
+        }
+    }
+
+    overscan[0] = (display_y_pix - area_y) / 2;
+    overscan[1] = display_y_pix - area_y - overscan[0];
+    overscan[2] = (display_x_pix - area_x) / 2;
+    overscan[3] = display_x_pix - area_x - overscan[2];
+}
+
 /*------------------------------------------------
  * fb_emul()
  *
  * Display card emulation function.
  * Source: http://stanislavs.org/helppc/int_10.html
  *
- * param:  list of 8088 CPU registers matching INT 10h BIOS call
+ * param:  list of 8088 CPU registers matching INT 10h BIOS call,
+ *         and command's trailing data bytes and their count
  * return: none
  *
  */
-void fb_emul(cmd_param_t* emul_command)
+void fb_emul(cmd_param_t* emul_command, uint8_t* data, int data_count)
 {
     int         i;
+    uint32_t    mode_switch_time;
 
     // Initialization check
     if ( active_emulation == -1 || active_page == -1 || page_size == 0 )
@@ -330,9 +714,15 @@ void fb_emul(cmd_param_t* emul_command)
         /* Set video mode
          *
          */
+        mode_switch_time = bcm2835_st_read();
+
         fb_init(FB_MODE);
         for (i = 0; i < graphics_mode[active_emulation].pages; i++)
-            fb_clear_screen(i);
+            page_needs_clear[i] = 1;
+        fb_clear_screen(active_page);
+
+        debug(DB_INFO, "%s: mode %d set in %d uSec\n", __FUNCTION__, active_emulation,
+                       (int)(bcm2835_st_read() - mode_switch_time));
     }
     else if ( FB_COMMAND == UART_CMD_DSP_PAGE )
     {
@@ -341,11 +731,12 @@ void fb_emul(cmd_param_t* emul_command)
          */
         if ( FB_PAGE < graphics_mode[active_emulation].pages )
         {
+            fb_touch_page(FB_PAGE);
             active_page = FB_PAGE;
 
             bcm2835_mailbox_init();
             bcm2835_mailbox_add_tag(TAG_FB_SET_VIRT_OFFSET, 0, (active_page * var_info.yres));
-            if ( !bcm2835_mailbox_process() )
+            if ( !fb_mailbox_process(TAG_FB_SET_VIRT_OFFSET) )
             {
                 debug(DB_ERR, "%S: error changing display page\n", __FUNCTION__);
             }
@@ -376,12 +767,15 @@ void fb_emul(cmd_param_t* emul_command)
 
         if ( FB_CUR_ROW < graphics_mode[active_emulation].rows )
             cursor_row = FB_CUR_ROW;
+
+        con_wrap_pending = 0;
     }
     else if ( FB_COMMAND == UART_CMD_CUR_MODE )
     {
         /* Cursor size/mode from scan lines
-         *
+         * Erase the cursor first, its rows change
          */
+        fb_cursor_on_off(0);
         cursor_start_line = FB_CUR_TOP_LINE;
         cursor_end_line = FB_CUR_BOT_LINE;
         if ( cursor_start_line == 0x20 && cursor_end_line == 0x00 )
@@ -394,6 +788,7 @@ void fb_emul(cmd_param_t* emul_command)
         /* Put character on the display
          *
          */
+        fb_touch_page(FB_PAGE);
         fb_put_char(FB_PAGE, FB_CUR_COLUMN, FB_CUR_ROW, FB_CHARACTER, FB_CHAR_ATTRIB);
     }
     else if ( FB_COMMAND == UART_CMD_GET_CHR )
@@ -401,6 +796,7 @@ void fb_emul(cmd_param_t* emul_command)
         /* Get character and attribute at cursor position
          *
          */
+        fb_touch_page(FB_PAGE);
         fb_get_char_and_attrib(FB_PAGE, FB_CUR_COLUMN, FB_CUR_ROW);
     }
     else if ( FB_COMMAND == UART_CMD_PUT_CHR )
@@ -408,6 +804,7 @@ void fb_emul(cmd_param_t* emul_command)
         /* Put character on the display
          *
          */
+        fb_touch_page(FB_PAGE);
         fb_put_char(FB_PAGE, FB_CUR_COLUMN, FB_CUR_ROW, FB_CHARACTER, FB_ATTR_USECURRECT);
     }
     else if ( FB_COMMAND == UART_CMD_SCR_UP )
@@ -433,6 +830,7 @@ void fb_emul(cmd_param_t* emul_command)
         /* Put pixel
          *
          */
+        fb_touch_page(FB_PAGE);
         fb_put_pixel(FB_PAGE, FB_PIX_COLOR, FB_PIX_COL, FB_PIX_ROW);
     }
     else if ( FB_COMMAND == UART_CMD_GET_PIX )
@@ -440,6 +838,7 @@ void fb_emul(cmd_param_t* emul_command)
         /* Get pixel
          *
          */
+        fb_touch_page(FB_PAGE);
         fb_get_pixel(FB_PAGE, FB_PIX_COL, FB_PIX_ROW);
     }
     else if ( FB_COMMAND == UART_CMD_PALETTE )
@@ -448,6 +847,28 @@ void fb_emul(cmd_param_t* emul_command)
          *
          */
         palette = FB_PALETTE;       // TODO trust BIOS or range check?
+        if ( plane == 0 || plane->bpp != 8 )
+        {
+            fb_build_palette_banks();
+            fb_palette_update(FB_PAL_GR4, 4);
+        }
+    }
+    else if ( FB_COMMAND == UART_CMD_DAC_WRITE )
+    {
+        /* Load a range of VGA DAC colors,
+         * data bytes are red, green and blue 6-bit triplets
+         *
+         */
+        fb_dac_write(FB_DAC_INDEX, data, data_count / 3);
+    }
+    else if ( FB_COMMAND == UART_CMD_PIX_WRITE )
+    {
+        /* Write a block of 256 color pixels,
+         * data bytes fill rows of 'width' pixels
+         *
+         */
+        fb_touch_page(0);
+        fb_pix_write(FB_BLK_X, FB_BLK_Y, FB_BLK_WIDTH, data, data_count);
     }
     else if ( FB_COMMAND == UART_CMD_CLR_SCR )
     {
@@ -456,6 +877,111 @@ void fb_emul(cmd_param_t* emul_command)
          */
         fb_clear_screen(FB_PAGE);
     }
+    else if ( FB_COMMAND == UART_CMD_LINE ||
+              FB_COMMAND == UART_CMD_RECT ||
+              FB_COMMAND == UART_CMD_FILL_RECT )
+    {
+        /* Draw a line or a rectangle between two corners
+         *
+         */
+        if ( data_count < 8 )
+        {
+            debug(DB_ERR, "%s: missing coordinates\n", __FUNCTION__);
+            return;
+        }
+
+        fb_touch_page(FB_PAGE);
+
+        if ( FB_COMMAND == UART_CMD_LINE )
+            fb_draw_line(FB_PAGE, FB_DRAW_COLOR, FB_DATA_WORD(0), FB_DATA_WORD(1), FB_DATA_WORD(2), FB_DATA_WORD(3));
+        else
+            fb_draw_rect(FB_PAGE, FB_DRAW_COLOR, FB_DATA_WORD(0), FB_DATA_WORD(1), FB_DATA_WORD(2), FB_DATA_WORD(3),
+                         (FB_COMMAND == UART_CMD_FILL_RECT));
+    }
+    else if ( FB_COMMAND == UART_CMD_SPAN )
+    {
+        /* Draw a horizontal span
+         *
+         */
+        if ( data_count < 6 )
+        {
+            debug(DB_ERR, "%s: missing coordinates\n", __FUNCTION__);
+            return;
+        }
+
+        fb_touch_page(FB_PAGE);
+        fb_draw_span(FB_PAGE, FB_DRAW_COLOR, FB_DATA_WORD(0), FB_DATA_WORD(1), FB_DATA_WORD(2));
+    }
+    else if ( FB_COMMAND == UART_CMD_COPY_RECT )
+    {
+        /* Copy a rectangle to another position on the page
+         *
+         */
+        if ( data_count < 12 )
+        {
+            debug(DB_ERR, "%s: missing coordinates\n", __FUNCTION__);
+            return;
+        }
+
+        fb_touch_page(FB_PAGE);
+        fb_copy_rect(FB_PAGE, FB_DRAW_COLOR, FB_DATA_WORD(0), FB_DATA_WORD(1), FB_DATA_WORD(2), FB_DATA_WORD(3),
+                     FB_DATA_WORD(4), FB_DATA_WORD(5));
+    }
+    else if ( FB_COMMAND == UART_CMD_COPY_TEXT )
+    {
+        /* Copy a text window between pages or within a page,
+         * optional data bytes hold the destination top left corner
+         *
+         */
+        if ( data_count >= 2 )
+            fb_copy_text(FB_SRC_PAGE, FB_DEST_PAGE, FB_COPY_TL_COL, FB_COPY_TL_ROW, FB_COPY_BR_COL, FB_COPY_BR_ROW, data[0], data[1]);
+        else
+            fb_copy_text(FB_SRC_PAGE, FB_DEST_PAGE, FB_COPY_TL_COL, FB_COPY_TL_ROW, FB_COPY_BR_COL, FB_COPY_BR_ROW, FB_COPY_TL_COL, FB_COPY_TL_ROW);
+    }
+    else if ( FB_COMMAND == UART_CMD_TELETYPE )
+    {
+        /* Write a run of characters at the cursor and advance the cursor
+         *
+         */
+        fb_teletype(FB_TTY_COLOR, data, data_count);
+    }
+    else if ( FB_COMMAND == UART_CMD_FONT_LOAD )
+    {
+        /* Load user font glyphs or restore the built-in font,
+         * data bytes are 'points' bytes for each character
+         *
+         */
+        if ( FB_FONT_COUNT == 0 )
+        {
+            fb_font_load(font_img, 0, FONT_CHARS, font_h);
+            fb_font_redraw(0, FONT_CHARS);
+            return;
+        }
+
+        if ( FB_FONT_POINTS == 0 || FB_FONT_POINTS > FONT_ROWS ||
+             (FB_FONT_FIRST + FB_FONT_COUNT) > FONT_CHARS ||
+             (FB_FONT_COUNT * FB_FONT_POINTS) > data_count )
+        {
+            debug(DB_ERR, "%s: invalid font load of %d characters with %d data bytes\n", __FUNCTION__, FB_FONT_COUNT, data_count);
+            return;
+        }
+
+        fb_font_load(data, FB_FONT_FIRST, FB_FONT_COUNT, FB_FONT_POINTS);
+        fb_font_redraw(FB_FONT_FIRST, FB_FONT_COUNT);
+    }
+    else if ( FB_COMMAND == UART_CMD_MEM_WRITE )
+    {
+        /* Write to video memory window
+         *
+         */
+        if ( FB_MEM_COUNT > data_count )
+        {
+            debug(DB_ERR, "%s: memory write of %d bytes with %d data bytes\n", __FUNCTION__, FB_MEM_COUNT, data_count);
+            return;
+        }
+
+        fb_mem_write(FB_MEM_OFFSET, data, FB_MEM_COUNT);
+    }
     else
     {
         debug(DB_ERR, "%s: emulation function %d not supported\n", __FUNCTION__, FB_COMMAND);
@@ -465,7 +991,11 @@ void fb_emul(cmd_param_t* emul_command)
 /*------------------------------------------------
  * fb_cursor_blink()
  *
- *  Call periodically to position and blink cursor
+ *  Call periodically to position and blink cursor, and
+ *  to blink characters with a blink attribute.
+ *  Characters blink by toggling the palette entries of the blink bank
+ *  between foreground and background colors, so the cost does not
+ *  depend on the number of blinking characters.
  *
  * param:  none
  * return: none
@@ -483,6 +1013,17 @@ void fb_cursor_blink()
         return;
     }
 
+    // Blink attribute
+    if ( blink_in_use &&
+         (bcm2835_st_read() - blink_time_check) > FB_ATTR_BLINK_INT )
+    {
+        blink_visible = blink_visible ? 0 : 1;
+        fb_build_blink_bank(blink_visible);
+        fb_palette_update(FB_PAL_BLINK, FB_PAL_BLINK_COLORS);
+
+        blink_time_check = bcm2835_st_read();
+    }
+
     // No cursor in graphics modes
     if ( graphics_mode[active_emulation].mode == MODE_NO ||
          graphics_mode[active_emulation].mode == MODE_GR )
@@ -524,10 +1065,44 @@ void fb_cursor_blink()
     }
 }
 
+/*------------------------------------------------
+ * fb_idle()
+ *
+ *  Call when there are no commands to process.
+ *  Clears one page that is waiting to be cleared since the last mode set,
+ *  so that the work is spread over idle loop iterations.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void fb_idle(void)
+{
+    int     i;
+
+    // initialization check
+    if ( active_emulation == -1 || active_page == -1 || page_size == 0 )
+    {
+        return;
+    }
+
+    for ( i = 0; i < graphics_mode[active_emulation].pages; i++ )
+    {
+        if ( page_needs_clear[i] )
+        {
+            fb_clear_page(i);
+            break;
+        }
+    }
+}
+
 /*------------------------------------------------
  * fb_cursor_on_off()
  *
  *  Turn cursor on or off.
+ *  The rows that are drawn are remembered, so that turning the cursor off
+ *  restores them after the cursor shape changed, and does nothing if
+ *  the cursor is not drawn.
  *
  * param:  1=on, 0=off
  * return: none
@@ -535,12 +1110,27 @@ void fb_cursor_blink()
  */
 void fb_cursor_on_off(int cursor_state)
 {
-    int         page_offset;
+    int         page_offset, first_row, last_row;
     uint8_t     cur_attr, cur_char;
 
     uint8_t     fg_color = VGA_DEF_MONO_FG_TXT;
     uint8_t     bg_color = VGA_DEF_MONO_BG_TXT;
 
+    if ( cursor_state )
+    {
+        first_row = cursor_start_line;
+        last_row = (cursor_end_line < font_h) ? cursor_end_line : (font_h - 1);
+    }
+    else if ( cursor_drawn )
+    {
+        first_row = cursor_drawn_first;
+        last_row = cursor_drawn_last;
+    }
+    else
+    {
+        return;
+    }
+
     /* Retrieve character attribute at cursor position
      */
     page_offset = active_page * graphics_mode[active_emulation].cols * graphics_mode[active_emulation].rows +
@@ -550,34 +1140,21 @@ void fb_cursor_on_off(int cursor_state)
     cur_char = (uint8_t)(text_pages[page_offset] & 0x00ff);
     cur_attr = (uint8_t)((text_pages[page_offset] >> 8) & 0x00ff);
 
-    /* Color settings
+    /* Color and monochrome text modes
      */
-    if ( active_emulation >= 0 && active_emulation <= 3 )
+    if ( graphics_mode[active_emulation].mode == MODE_TX )
     {
-        fg_color = cur_attr & 0x0f;
-        bg_color = (cur_attr >> 4) & 0x0f;
+        fb_text_colors(cur_attr, &fg_color, &bg_color);
     }
     /* Ignore in graphics modes
      */
-    else if ( active_emulation >= 4 && active_emulation <= 6 )
+    else if ( graphics_mode[active_emulation].mode == MODE_GR )
     {
         /* No cursor in graphics modes, so do nothing.
          * This is here just for protection and as place holder.
          *
          */
-    }
-    /* Monochrome text modes
-     */
-    else if ( active_emulation == 7 || active_emulation == 9 )
-    {
-        if ( cur_attr == FB_ATTR_HIGHINTUL || cur_attr == FB_ATTR_HIGHINT )
-            fg_color = VGA_DEF_MONO_HFG_TXT;
-        else if ( cur_attr == FB_ATTR_HIDE )
-            fg_color = VGA_DEF_MONO_BG_TXT;
-        else
-            fg_color = VGA_DEF_MONO_FG_TXT;
-
-        bg_color = VGA_DEF_MONO_BG_TXT;
+        return;
     }
     else
     {
@@ -585,9 +1162,14 @@ void fb_cursor_on_off(int cursor_state)
         return;
     }
 
-    /* Redraw the character
+    /* Redraw only the character rows under the cursor
      */
-    fb_draw_char(active_page, cursor_column_prev, cursor_row_prev, cur_char, fg_color, bg_color, cur_attr, cursor_state);
+    fb_draw_cursor_rows(active_page, cursor_column_prev, cursor_row_prev, cur_char, fg_color, bg_color, cur_attr,
+                        first_row, last_row, cursor_state);
+
+    cursor_drawn = (cursor_state && first_row <= last_row);
+    cursor_drawn_first = first_row;
+    cursor_drawn_last = last_row;
 }
 
 /********************************************************************
@@ -602,9 +1184,6 @@ void fb_cursor_on_off(int cursor_state)
  */
 void fb_clear_screen(int page)
 {
-    int         i, text_page_offset, text_page_size;
-    uint16_t    attr_char;
-
     // range checks
     if ( page >= graphics_mode[active_emulation].pages )
     {
@@ -612,10 +1191,35 @@ void fb_clear_screen(int page)
         return;
     }
 
+    fb_clear_page(page);
+
+    cursor_row = 0;
+    cursor_column = 0;
+    cursor_row_prev = 0;
+    cursor_column_prev = 0;
+    con_wrap_pending = 0;
+}
+
+/********************************************************************
+ * fb_clear_page()
+ *
+ *  Clear the frame buffer and the text buffer of a page,
+ *  and the video memory window in graphics modes.
+ *  Cursor position is not changed.
+ *
+ *  param:  page number
+ *  return: none
+ */
+void fb_clear_page(int page)
+{
+    int         i, text_page_offset, text_page_size;
+    uint16_t    attr_char;
+    uint8_t    *fb_line, color;
+
     // color settings
     if ( active_emulation >= 0 && active_emulation <= 3 )
         attr_char = (((uint16_t)VGA_DEF_COLR_BG_TXT << 12) + ((uint16_t)VGA_DEF_COLR_FG_TXT << 8)) + 32;
-    else if ( active_emulation >= 4 && active_emulation <= 6 )
+    else if ( graphics_mode[active_emulation].mode == MODE_GR )
         attr_char = 32;
     else if ( active_emulation == 7 || active_emulation == 9 )
         attr_char = ((uint16_t)FB_ATTR_NORMAL << 8) + 32;
@@ -632,12 +1236,36 @@ void fb_clear_screen(int page)
     for (i = 0; i < text_page_size; i++)
         text_pages[text_page_offset + i] = attr_char;
 
-    memset(fbp + active_page * page_size, FB_BLACK, page_size);
+    // graphics modes clear to the color of video memory pixel value 0
+    if ( plane )
+        color = plane_colors[0];
+    else
+        color = FB_BLACK;
 
-    cursor_row = 0;
-    cursor_column = 0;
-    cursor_row_prev = 0;
-    cursor_column_prev = 0;
+    // clear only the visible part of each line, the rest of the pitch is not displayed
+    fb_line = fbp + page * page_size;
+    for (i = 0; i < var_info.yres; i++, fb_line += var_info.pitch)
+        memset(fb_line, color, var_info.xres);
+
+    if ( graphics_mode[active_emulation].mode == MODE_GR )
+        memset(vram, 0, VRAM_SIZE);
+
+    page_needs_clear[page] = 0;
+}
+
+/********************************************************************
+ * fb_touch_page()
+ *
+ *  Clear a page that was not cleared since the last mode set,
+ *  call before a page is displayed, written or read.
+ *
+ *  param:  page number
+ *  return: none
+ */
+void fb_touch_page(int page)
+{
+    if ( page < graphics_mode[active_emulation].pages && page_needs_clear[page] )
+        fb_clear_page(page);
 }
 
 /********************************************************************
@@ -667,12 +1295,12 @@ void fb_clear_fbuffer_window(int page, uint8_t color, uint8_t tl_col, uint8_t tl
     // Clear the window
     pixel_offset = (active_page * page_size ) +
                    (tl_col * font_w) +
-                   (tl_row * font_h * var_info.xres);
+                   (tl_row * font_h * var_info.pitch);
     fb_from = (void*)(fbp + pixel_offset);
 
     for ( i = 0; i < count; i++ )
     {
-        pixel_offset = i * var_info.xres;
+        pixel_offset = i * var_info.pitch;
         memset((void*)((uint8_t*)fb_from + pixel_offset), color, (cols*font_w));
     }
 }
@@ -730,17 +1358,14 @@ void fb_draw_pixel(int page, uint16_t x, uint16_t y, uint8_t color)
         return;
 
     // range checks
-    if ( color > FB_WHITE || color < FB_BLACK )
-        return;
-
     if ( page >= graphics_mode[active_emulation].pages )
         return;
 
     // calculate the pixel's byte offset inside the buffer
     pix_offset = x + y * var_info.pitch;
 
-    // offset by the current buffer start
-    pix_offset += active_page * page_size;
+    // offset by the page buffer start
+    pix_offset += page * page_size;
 
     // The same as 'fbp[pix_offset] = value'
     *(fbp + pix_offset) = color;
@@ -766,66 +1391,298 @@ void fb_draw_char(int page, uint8_t x, uint8_t y, uint8_t c,
                   uint8_t fg_color, uint8_t bg_color, uint8_t attribute,
                   int cursor_on)
 {
-    uint8_t     pix_pos, bit_pattern;
-    int         col, row;
+    uint8_t     bit_pattern;
+    int         row, col;
     int         px, py;
-    int         bit_pattern_index;
-
-    if ( fg_color > FB_WHITE )
-        return;
+    uint32_t    fg_word, bg_word;
+    uint32_t    masks[2];
+    uint32_t    fb_offset;
+    uint32_t   *fb_word;
 
-    if ( bg_color > FB_WHITE && bg_color != FB_TRANSPARENT )
+    if ( fg_color == FB_TRANSPARENT )
         return;
 
     if ( page >= graphics_mode[active_emulation].pages )
         return;
 
+    fg_word = fg_color * 0x01010101;
+    bg_word = bg_color * 0x01010101;
+
+    px = x * font_w;
+
     /* Print character rows starting at the top row,
-     * print the pixel columns, starting on the left
+     * each row is written as two 32-bit words from the glyph atlas
+     * when the character cell is word aligned
+     * TODO NOTE: only 8 pixel columns even for 9-pix font width
      */
     for ( row = 0; row < font_h; row++ )
     {
-        pix_pos = 0x80;
         py = y * font_h + row;
+        fb_offset = page * page_size + py * var_info.pitch + px;
 
-        bit_pattern_index = (int)c * font_h + row;
-        bit_pattern = font_img[bit_pattern_index];
+        if ( (fb_offset & 3) == 0 )
+        {
+            fb_char_row_masks(c, row, attribute, masks);
 
-        /* Adjust attributes for monochrome text modes
-         */
-        if ( active_emulation == 7 || active_emulation == 9 )
+            /* Adjust foreground and background to render cursor
+             */
+            if ( cursor_on &&
+                 row >= cursor_start_line && row <= cursor_end_line )
+            {
+                masks[0] = ~masks[0];
+                masks[1] = ~masks[1];
+            }
+
+            fb_word = (uint32_t*)(fbp + fb_offset);
+            fb_word[0] = (fg_word & masks[0]) | (bg_word & ~masks[0]);
+            fb_word[1] = (fg_word & masks[1]) | (bg_word & ~masks[1]);
+        }
+        else
         {
-            // underline mode
-            if ( (row == font_h - 2) && (attribute == FB_ATTR_UNDERLIN || attribute == FB_ATTR_HIGHINTUL) )
-                bit_pattern = 0xff;
-            else if ( attribute == FB_ATTR_INV )
+            bit_pattern = fb_char_row_bits(c, row, attribute);
+
+            if ( cursor_on &&
+                 row >= cursor_start_line && row <= cursor_end_line )
+            {
                 bit_pattern = ~bit_pattern;
+            }
+
+            for ( col = 0; col < 8; col++ )
+            {
+                fbp[fb_offset + col] = (bit_pattern & (0x80 >> col)) ? fg_color : bg_color;
+            }
         }
+    }
+}
 
-        /* Adjust foreground and background to render cursor
-         */
-        if ( cursor_on &&
-             row >= cursor_start_line && row <= cursor_end_line )
+/*------------------------------------------------
+ * fb_draw_cursor_rows()
+ *
+ * Draw only the character rows under the cursor,
+ * with the font pattern inverted when the cursor is on.
+ * This is the same as an XOR of the cursor rows, but does not
+ * read the frame buffer. Each row is written as two 32-bit words
+ * when the character cell is word aligned.
+ *
+ * param:  page          display page number
+ *         x             horizontal position of the top left corner of the character, columns from the left edge
+ *         y             vertical position of the top left corner of the character, rows from the top edge
+ *         c             character under the cursor
+ *         fg_color      foreground color of the character
+ *         bg_color      background color of the character
+ *         attribute     character attribute for monochrome modes
+ *         first_row     first and last character row of the cursor
+ *         last_row
+ *         cursor_on     draw cursor rows inverted (on) or normal (off)
+ * return: none
+ *
+ */
+void fb_draw_cursor_rows(int page, uint8_t x, uint8_t y, uint8_t c,
+                         uint8_t fg_color, uint8_t bg_color, uint8_t attribute,
+                         int first_row, int last_row, int cursor_on)
+{
+    uint8_t     bit_pattern;
+    int         row;
+    int         col, px, py;
+    uint32_t    fg_word, bg_word;
+    uint32_t    masks[2];
+    uint32_t    fb_offset;
+    uint32_t   *fb_word;
+
+    if ( fg_color == FB_TRANSPARENT )
+        return;
+
+    if ( page >= graphics_mode[active_emulation].pages )
+        return;
+
+    fg_word = fg_color * 0x01010101;
+    bg_word = bg_color * 0x01010101;
+
+    px = x * font_w;
+
+    for ( row = first_row; row <= last_row; row++ )
+    {
+        py = y * font_h + row;
+
+        fb_offset = page * page_size + py * var_info.pitch + px;
+
+        if ( (fb_offset & 3) == 0 )
         {
-            bit_pattern = ~bit_pattern;
-        }
+            fb_char_row_masks(c, row, attribute, masks);
+            if ( cursor_on )
+            {
+                masks[0] = ~masks[0];
+                masks[1] = ~masks[1];
+            }
 
-        /* TODO NOTE: only cycles through 8 pixel bits even for 9-pix font width
-         */
-        for ( col = 0; col < 8; col++ )
+            fb_word = (uint32_t*)(fbp + fb_offset);
+            fb_word[0] = (fg_word & masks[0]) | (bg_word & ~masks[0]);
+            fb_word[1] = (fg_word & masks[1]) | (bg_word & ~masks[1]);
+        }
+        else
         {
-            px = x * font_w + col;
+            bit_pattern = fb_char_row_bits(c, row, attribute);
+            if ( cursor_on )
+                bit_pattern = ~bit_pattern;
 
-            if ( (bit_pattern & pix_pos) )
+            for ( col = 0; col < 8; col++ )
             {
-                fb_draw_pixel(page, px, py, fg_color);
+                fbp[fb_offset + col] = (bit_pattern & (0x80 >> col)) ? fg_color : bg_color;
             }
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_char_row_bits()
+ *
+ * Return the font bit pattern of one character row,
+ * adjusted for underline and inverse attributes in monochrome text modes.
+ *
+ * param:  c             character
+ *         row           character row, 0 is the top row
+ *         attribute     character attribute
+ * return: row bit pattern, bit 7 is the left most pixel
+ *
+ */
+uint8_t fb_char_row_bits(uint8_t c, int row, uint8_t attribute)
+{
+    uint8_t     bit_pattern, mono_attribute;
+
+    bit_pattern = font_ram[(int)c * FONT_ROWS + row];
+
+    if ( active_emulation == 7 || active_emulation == 9 )
+    {
+        mono_attribute = attribute & ~FB_ATTR_BLINK;
+
+        // underline mode
+        if ( (row == font_h - 2) && (mono_attribute == FB_ATTR_UNDERLIN || mono_attribute == FB_ATTR_HIGHINTUL) )
+            bit_pattern = 0xff;
+        else if ( mono_attribute == FB_ATTR_INV )
+            bit_pattern = ~bit_pattern;
+    }
+
+    return bit_pattern;
+}
+
+/*------------------------------------------------
+ * fb_char_row_masks()
+ *
+ * Return one character row from the glyph atlas as byte masks of
+ * the left and right four pixels, adjusted for underline and inverse
+ * attributes in monochrome text modes like fb_char_row_bits().
+ *
+ * param:  c             character
+ *         row           character row, 0 is the top row
+ *         attribute     character attribute
+ *         masks         two byte masks, the left most pixel is in the low byte of masks[0]
+ * return: none
+ *
+ */
+void fb_char_row_masks(uint8_t c, int row, uint8_t attribute, uint32_t *masks)
+{
+    uint8_t     mono_attribute;
+
+    masks[0] = font_atlas[(int)c * FONT_ROWS + row][0];
+    masks[1] = font_atlas[(int)c * FONT_ROWS + row][1];
+
+    if ( active_emulation == 7 || active_emulation == 9 )
+    {
+        mono_attribute = attribute & ~FB_ATTR_BLINK;
+
+        // underline mode
+        if ( (row == font_h - 2) && (mono_attribute == FB_ATTR_UNDERLIN || mono_attribute == FB_ATTR_HIGHINTUL) )
+        {
+            masks[0] = 0xffffffff;
+            masks[1] = 0xffffffff;
+        }
+        else if ( mono_attribute == FB_ATTR_INV )
+        {
+            masks[0] = ~masks[0];
+            masks[1] = ~masks[1];
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_font_load()
+ *
+ *  Load character glyphs into the active font, and rebuild
+ *  their glyph atlas rows.
+ *  Glyphs shorter than the character cell are padded with blank rows,
+ *  and taller glyphs are cut to the cell height.
+ *
+ * param:  font          glyph bitmaps, 'points' bytes per character
+ *         first         first character code to load
+ *         count         number of characters
+ *         points        bytes per character in the source glyph bitmaps
+ * return: none
+ *
+ */
+void fb_font_load(uint8_t *font, int first, int count, int points)
+{
+    int         c, row;
+    uint8_t     bit_pattern;
+
+    for ( c = first; c < (first + count); c++ )
+    {
+        for ( row = 0; row < FONT_ROWS; row++ )
+        {
+            if ( row < points && row < font_h )
+                bit_pattern = font[(c - first) * points + row];
             else
-            {
-                fb_draw_pixel(page, px, py, bg_color);
-            }
+                bit_pattern = 0;
+
+            font_ram[c * FONT_ROWS + row] = bit_pattern;
+            font_atlas[c * FONT_ROWS + row][0] = nibble_mask[bit_pattern >> 4];
+            font_atlas[c * FONT_ROWS + row][1] = nibble_mask[bit_pattern & 0x0f];
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_font_redraw()
+ *
+ *  Redraw the characters of the text pages that use a range
+ *  of character codes, after their glyphs were changed.
+ *  Graphics modes use the new glyphs only for characters written
+ *  after the change, same as the BIOS.
+ *
+ * param:  first         first character code
+ *         count         number of characters
+ * return: none
+ *
+ */
+void fb_font_redraw(int first, int count)
+{
+    int         page, cell, cells, page_offset;
+    uint8_t     c, attribute, fg_color, bg_color;
+
+    if ( active_emulation == -1 || graphics_mode[active_emulation].mode != MODE_TX )
+        return;
+
+    cells = graphics_mode[active_emulation].cols * graphics_mode[active_emulation].rows;
+
+    for ( page = 0; page < graphics_mode[active_emulation].pages; page++ )
+    {
+        // cleared pages are drawn with the new glyphs when they are used
+        if ( page_needs_clear[page] )
+            continue;
 
-            pix_pos = pix_pos >> 1;
+        page_offset = page * cells;
+
+        for ( cell = 0; cell < cells; cell++ )
+        {
+            c = (uint8_t)(text_pages[page_offset + cell] & 0x00ff);
+            if ( c < first || c >= (first + count) )
+                continue;
+
+            attribute = (uint8_t)(text_pages[page_offset + cell] >> 8);
+            fb_text_colors(attribute, &fg_color, &bg_color);
+            fb_draw_char(page,
+                         cell % graphics_mode[active_emulation].cols,
+                         cell / graphics_mode[active_emulation].cols,
+                         c, fg_color, bg_color, attribute, 0);
         }
     }
 }
@@ -868,38 +1725,19 @@ void fb_put_char(int page, uint8_t x, uint8_t y, uint8_t c, uint8_t attribute)
 
             attr_char = ((uint16_t)cur_attr << 8) + c;
 
-            // Monochrome text attributes
-            if ( active_emulation == 7 || active_emulation == 9 )
-            {
-                if ( cur_attr == FB_ATTR_HIGHINTUL || cur_attr == FB_ATTR_HIGHINT)
-                    fg_color = VGA_DEF_MONO_HFG_TXT;
-                else if ( cur_attr == FB_ATTR_HIDE )
-                    fg_color = VGA_DEF_MONO_BG_TXT;
-                else
-                    fg_color = VGA_DEF_MONO_FG_TXT;
-
-                bg_color = VGA_DEF_MONO_BG_TXT;
-            }
-            // Color text attributes
-            else
-            {
-                fg_color = (cur_attr & 0x0f);
-                bg_color = ((cur_attr >> 4) & 0x0f);
-            }
+            fb_text_colors(cur_attr, &fg_color, &bg_color);
         }
 
-        /* In graphics modes (4, 5, and 6) only save the character code in the shadow text page
-         * and draw the character with a transparent background over the graphics page
-         * using the color provided in the attribute byte
+        /* In graphics modes (4, 5, 6, and 8) only save the character code in the shadow text page
+         * and draw the character with a transparent background into the video memory shadow
+         * using the pixel value provided in the attribute byte
          */
         else
         {
             attr_char = ((uint16_t)attribute << 8) + c;
-            fg_color = attribute;
-            if ( active_emulation == 6 )
-                fg_color = ( fg_color > 0 ) ? FB_WHITE : FB_BLACK;  // adjust for monochrome mode
-            bg_color = FB_TRANSPARENT;
-            cur_attr = FB_ATTR_USECURRECT;
+            text_pages[page_offset] = attr_char;
+            fb_plane_char(x, y, c, attribute);
+            return;
         }
 
         text_pages[page_offset] = attr_char;
@@ -912,6 +1750,51 @@ void fb_put_char(int page, uint8_t x, uint8_t y, uint8_t c, uint8_t attribute)
     }
 }
 
+/*------------------------------------------------
+ * fb_text_colors()
+ *
+ *  Translate a character attribute into foreground and background
+ *  colors of the active color or monochrome text mode.
+ *  Attribute bit 7 selects blinking in color and monochrome modes, as on
+ *  the CGA and MDA, and the foreground color of a blinking character is
+ *  taken from the blink palette bank.
+ *
+ * param:  attribute, pointers to foreground and background colors
+ * return: none
+ *
+ */
+void fb_text_colors(uint8_t attribute, uint8_t *fg_color, uint8_t *bg_color)
+{
+    uint8_t     mono_attribute;
+
+    // Monochrome text attributes
+    if ( active_emulation == 7 || active_emulation == 9 )
+    {
+        mono_attribute = attribute & ~FB_ATTR_BLINK;
+
+        if ( mono_attribute == FB_ATTR_HIGHINTUL || mono_attribute == FB_ATTR_HIGHINT)
+            *fg_color = VGA_DEF_MONO_HFG_TXT;
+        else if ( mono_attribute == FB_ATTR_HIDE )
+            *fg_color = VGA_DEF_MONO_BG_TXT;
+        else
+            *fg_color = VGA_DEF_MONO_FG_TXT;
+
+        *bg_color = VGA_DEF_MONO_BG_TXT;
+    }
+    // Color text attributes
+    else
+    {
+        *fg_color = (attribute & 0x0f);
+        *bg_color = ((attribute >> 4) & 0x07);
+    }
+
+    if ( (attribute & FB_ATTR_BLINK) && *bg_color < 8 )
+    {
+        *fg_color = FB_PAL_BLINK + (*bg_color << 4) + *fg_color;
+        blink_in_use = 1;
+    }
+}
+
 /*------------------------------------------------
  * fb_scroll_fbuffer()
  *
@@ -941,19 +1824,22 @@ void fb_scroll_fbuffer(uint8_t dir, uint8_t tl_col, uint8_t tl_row, uint8_t br_c
         return;
     }
 
-    // Extract the fill color of the cleared rows from the attribute
-    if ( active_emulation >= 0 && active_emulation <= 3 )
+    // Graphics modes scroll the video memory shadow
+    if ( plane )
     {
-        fill_color = ((attrib >> 4) & 0x0f);
+        fb_plane_scroll(dir, tl_col, tl_row, br_col, br_row, count, attrib);
+        return;
     }
-    else if ( active_emulation >= 4 && active_emulation <= 6 )
+
+    // Extract the fill color of the cleared rows from the attribute
+    if ( active_emulation >= 0 && active_emulation <= 3 )
     {
-        fill_color = attrib;
+        fill_color = ((attrib >> 4) & 0x07);
     }
     else if ( active_emulation == 7 || active_emulation == 9 )
     {
         // In a monochrome text mode use the background of normal, high intensity or inverse video
-        if ( attrib == FB_ATTR_INV)
+        if ( (attrib & ~FB_ATTR_BLINK) == FB_ATTR_INV)
             fill_color = VGA_DEF_MONO_FG_TXT;
         else
             fill_color = VGA_DEF_MONO_BG_TXT;
@@ -971,17 +1857,17 @@ void fb_scroll_fbuffer(uint8_t dir, uint8_t tl_col, uint8_t tl_row, uint8_t br_c
             // Scroll pixel rows up
             pixel_offset = (active_page * page_size ) +
                            (tl_col * font_w) +
-                           ((tl_row + count) * font_h * var_info.xres);
+                           ((tl_row + count) * font_h * var_info.pitch);
             fb_from = (void*)(fbp + pixel_offset);
 
             pixel_offset = (active_page * page_size ) +
                            (tl_col * font_w) +
-                           (tl_row * font_h * var_info.xres);
+                           (tl_row * font_h * var_info.pitch);
             fb_to = (void*)(fbp + pixel_offset);
 
             for ( i = 0; i < ((rows - count) * font_h); i++ )
             {
-                pixel_offset = i * var_info.xres;
+                pixel_offset = i * var_info.pitch;
                 memmove((void*)((uint8_t*)fb_to + pixel_offset), (void*)((uint8_t*)fb_from + pixel_offset), (cols*font_w));
             }
 
@@ -993,17 +1879,17 @@ void fb_scroll_fbuffer(uint8_t dir, uint8_t tl_col, uint8_t tl_row, uint8_t br_c
             // Scroll pixel rows down
             pixel_offset = (active_page * page_size ) +
                            (tl_col * font_w) +
-                           ((((br_row + 1 - count) * font_h) - 1) * var_info.xres);
+                           ((((br_row + 1 - count) * font_h) - 1) * var_info.pitch);
             fb_from = (void*)(fbp + pixel_offset);
 
             pixel_offset = (active_page * page_size ) +
                            (tl_col * font_w) +
-                           ((((br_row + 1) * font_h) - 1) * var_info.xres);
+                           ((((br_row + 1) * font_h) - 1) * var_info.pitch);
             fb_to = (void*)(fbp + pixel_offset);
 
             for ( i = 0; i < ((rows - count) * font_h); i++ )
             {
-                pixel_offset = i * var_info.xres;
+                pixel_offset = i * var_info.pitch;
                 memmove((void*)((uint8_t*)fb_to - pixel_offset), (void*)((uint8_t*)fb_from - pixel_offset), (cols*font_w));
             }
 
@@ -1134,87 +2020,1517 @@ void fb_get_char_and_attrib(uint8_t page, uint8_t column, uint8_t row)
 }
 
 /*------------------------------------------------
- * fb_put_pixel()
+ * fb_teletype()
  *
- *  Put a pixel on a graphics-mode screen
+ *  Write a run of characters to the active page at the cursor position,
+ *  same as INT 10h function 0Eh.
+ *  The new cursor position is sent back when all characters are written.
  *
- * param:  page number, pixel color, x and y coordinates
- * return: none
+ * param:  foreground pixel color in graphics modes, characters, character count
+ * return: send cursor column and row through UART
  *
  */
-void fb_put_pixel(int page, uint8_t color, uint16_t x, uint16_t y)
+void fb_teletype(uint8_t color, uint8_t *data, int count)
 {
-    uint8_t     c, pixel_color;
-    int         do_color_xor, pixel_offset;
+    // text modes keep the attribute of the character cell
+    if ( graphics_mode[active_emulation].mode == MODE_TX )
+        fb_con_write(FB_ATTR_USECURRECT, FB_ATTR_USECURRECT, data, count, 0);
+    else
+        fb_con_write(color, 0, data, count, 0);
 
-    if (  graphics_mode[active_emulation].mode != MODE_GR )
-    {
-        debug(DB_ERR, "%s: invalid mode\n", __FUNCTION__);
-        return;
-    }
+    uart_send((uint8_t)cursor_column);
+    uart_send((uint8_t)cursor_row);
+}
 
-    do_color_xor = color & FB_XOR_PIXEL;    // check if XOR required
-    c = color & ~FB_XOR_PIXEL;              // isolate color
+/*------------------------------------------------
+ * fb_frame_hash()
+ *
+ *  FNV-1a hash of the RGB colors of the displayed page's pixels,
+ *  for comparing frames of a replayed command stream between builds.
+ *  The host simulation hashes its frame buffer the same way.
+ *
+ * param:  none
+ * return: hash
+ *
+ */
+uint32_t fb_frame_hash(void)
+{
+    int         x, y;
+    uint32_t    hash, color;
+    uint8_t    *line;
 
-    if ( c != FB_BLACK )
+    hash = 2166136261U;
+
+    if ( active_emulation == -1 || active_page == -1 || page_size == 0 )
+        return hash;
+
+    for ( y = 0; y < var_info.yres; y++ )
     {
-        if ( active_emulation == 4 || active_emulation == 5 )
-        {
-            c = ((c << 1) + palette) & 0x07;
-        }
-        else if ( active_emulation == 6 )
+        line = fbp + active_page * page_size + y * var_info.pitch;
+        for ( x = 0; x < var_info.xres; x++ )
         {
-            c = (c != 0) ? FB_WHITE : FB_BLACK;
+            color = palette_bgr[line[x]];
+            hash = (hash ^ (color & 0xff)) * 16777619U;
+            hash = (hash ^ ((color >> 8) & 0xff)) * 16777619U;
+            hash = (hash ^ ((color >> 16) & 0xff)) * 16777619U;
         }
     }
 
-    if ( do_color_xor )
-    {
-        // calculate the pixel's byte offset inside the buffer
-        pixel_offset = x + y * var_info.pitch;
-        pixel_offset += page * page_size;
+    return hash;
+}
 
-        // Get the pixel's color value and use it to XOR with new color
-        pixel_color = *(fbp + pixel_offset);
-        c ^= pixel_color;
-    }
+/*------------------------------------------------
+ * fb_get_mode_info()
+ *
+ *  Get the text and pixel geometry of a video mode.
+ *
+ * param:  mode, pointers to columns, rows, pixel width and pixel height
+ * return: 1 graphics mode, 0 text mode, -1 mode not emulated
+ *
+ */
+int fb_get_mode_info(int mode, int *columns, int *rows, int *width, int *height)
+{
+    if ( mode < 0 || mode >= MAX_MODES ||
+         graphics_mode[mode].mode == MODE_NO )
+        return -1;
+
+    *columns = graphics_mode[mode].cols;
+    *rows = graphics_mode[mode].rows;
+    *width = graphics_mode[mode].x_pix;
+    *height = graphics_mode[mode].y_pix;
 
-    fb_draw_pixel(page, x, y, c);
+    return (graphics_mode[mode].mode == MODE_GR);
 }
 
 /*------------------------------------------------
- * fb_get_pixel()
+ * fb_con_write()
  *
- *  Get a pixel's color value from a graphics-mode screen
+ *  Text console output for the teletype command and the terminal emulator.
+ *  Write a run of characters to the active page at the cursor position.
+ *  The cursor advances with every character, wraps at the end of a line,
+ *  and the scroll region scrolls up when the cursor moves past its bottom line.
+ *  The teletype wraps as soon as the last column is written, like the BIOS.
+ *  With a deferred wrap, like a VT100, the cursor stays on the last column
+ *  and the wrap happens when the next character is written; a cursor move,
+ *  CR, LF, or BS before that cancels the wrap.
+ *  CR, LF, and BS move the cursor, BEL is left to the PC/XT speaker and ignored.
  *
- * param:  page number, x and y coordinates
- * return: send color value through UART
+ * param:  character attribute or FB_ATTR_USECURRECT to keep the cell's attribute,
+ *         attribute of lines scrolled in or FB_ATTR_USECURRECT for the attribute at the cursor,
+ *         characters, character count, 0=immediate wrap or 1=deferred wrap
+ * return: none
  *
  */
-void fb_get_pixel(int page, uint16_t x, uint16_t y)
+void fb_con_write(uint8_t attribute, uint8_t fill_attribute, uint8_t *text, int count, int deferred_wrap)
 {
-    int     pixel_offset;
-    uint8_t color = 0;
+    int         i;
 
-    // range checks
-    if ( page >= graphics_mode[active_emulation].pages ||
-         x > (graphics_mode[active_emulation].cols * font_w) ||
-         y > (graphics_mode[active_emulation].rows * font_h) )
-    {
-        debug(DB_ERR, "%s: invalid mode, or page, or pixel position\n", __FUNCTION__);
-        color = 0;
-    }
-    else
+    if ( active_emulation == -1 || active_page == -1 || page_size == 0 )
+        return;
+
+    fb_touch_page(active_page);
+    fb_cursor_on_off(0);
+
+    for ( i = 0; i < count; i++ )
     {
-        // calculate the pixel's byte offset inside the buffer
-        pixel_offset = x + y * var_info.pitch;
+        switch ( text[i] )
+        {
+            case 0x07:      // BEL
+                break;
+
+            case 0x08:      // BS
+                con_wrap_pending = 0;
+                if ( cursor_column > 0 )
+                    cursor_column--;
+                break;
+
+            case 0x0a:      // LF
+                con_wrap_pending = 0;
+                fb_con_new_line(fill_attribute);
+                break;
+
+            case 0x0d:      // CR
+                con_wrap_pending = 0;
+                cursor_column = 0;
+                break;
+
+            default:
+                if ( con_wrap_pending )
+                {
+                    con_wrap_pending = 0;
+                    cursor_column = 0;
+                    fb_con_new_line(fill_attribute);
+                }
 
-        // offset by the current buffer start
-        pixel_offset += page * page_size;
+                fb_put_char(active_page, cursor_column, cursor_row, text[i], attribute);
 
-        // Get the pixel's color value
-        color = *(fbp + pixel_offset);
+                if ( cursor_column < (graphics_mode[active_emulation].cols - 1) )
+                {
+                    cursor_column++;
+                }
+                else if ( deferred_wrap )
+                {
+                    con_wrap_pending = 1;
+                }
+                else
+                {
+                    cursor_column = 0;
+                    fb_con_new_line(fill_attribute);
+                }
+        }
     }
+}
 
-    uart_send(color);
+/*------------------------------------------------
+ * fb_con_new_line()
+ *
+ *  Move the cursor to the next line, and scroll the scroll region up
+ *  by one line when the cursor is on the region's bottom line.
+ *  Like the BIOS, text modes fill the new line with the attribute at
+ *  the cursor when no attribute is given, and graphics modes fill
+ *  it with pixel value 0.
+ *
+ * param:  fill attribute or FB_ATTR_USECURRECT
+ * return: none
+ *
+ */
+void fb_con_new_line(uint8_t attribute)
+{
+    int         page_offset;
+
+    if ( cursor_row != con_bottom_row )
+    {
+        if ( cursor_row < (graphics_mode[active_emulation].rows - 1) )
+            cursor_row++;
+        return;
+    }
+
+    if ( graphics_mode[active_emulation].mode != MODE_TX )
+    {
+        attribute = 0;
+    }
+    else if ( attribute == FB_ATTR_USECURRECT )
+    {
+        page_offset = active_page * graphics_mode[active_emulation].cols * graphics_mode[active_emulation].rows +
+                      cursor_column + (cursor_row * graphics_mode[active_emulation].cols);
+        attribute = (uint8_t)(text_pages[page_offset] >> 8);
+    }
+
+    fb_con_scroll(0, con_top_row, con_bottom_row, 1, attribute);
+}
+
+/*------------------------------------------------
+ * fb_con_scroll()
+ *
+ *  Scroll full width lines of the active page.
+ *
+ * param:  dir           up=0 or down=1
+ *         top_row, bottom_row  lines to scroll
+ *         count         lines to scroll by
+ *         attribute     attribute to fill in cleared lines
+ * return: none
+ *
+ */
+void fb_con_scroll(int dir, int top_row, int bottom_row, int count, uint8_t attribute)
+{
+    uint8_t     last_col;
+
+    if ( active_emulation == -1 || active_page == -1 || page_size == 0 )
+        return;
+
+    if ( bottom_row >= graphics_mode[active_emulation].rows )
+        bottom_row = graphics_mode[active_emulation].rows - 1;
+
+    if ( count <= 0 || top_row < 0 || top_row > bottom_row )
+        return;
+
+    // scroll commands clear the window when the count is larger than the window
+    if ( count > (bottom_row - top_row + 1) )
+        count = bottom_row - top_row + 1;
+
+    last_col = graphics_mode[active_emulation].cols - 1;
+
+    fb_touch_page(active_page);
+    fb_cursor_on_off(0);
+    fb_scroll_fbuffer(dir, 0, top_row, last_col, bottom_row, count, attribute);
+    fb_scroll_tbuffer(dir, 0, top_row, last_col, bottom_row, count, attribute);
+}
+
+/*------------------------------------------------
+ * fb_con_erase()
+ *
+ *  Clear a window of the active page to a text attribute.
+ *
+ * param:  window in character coordinates, fill attribute
+ * return: none
+ *
+ */
+void fb_con_erase(int tl_col, int tl_row, int br_col, int br_row, uint8_t attribute)
+{
+    if ( active_emulation == -1 || active_page == -1 || page_size == 0 )
+        return;
+
+    if ( br_col >= graphics_mode[active_emulation].cols )
+        br_col = graphics_mode[active_emulation].cols - 1;
+    if ( br_row >= graphics_mode[active_emulation].rows )
+        br_row = graphics_mode[active_emulation].rows - 1;
+
+    if ( tl_col < 0 || tl_row < 0 || tl_col > br_col || tl_row > br_row )
+        return;
+
+    fb_touch_page(active_page);
+    fb_cursor_on_off(0);
+
+    // a scroll count of 0 clears the window
+    fb_scroll_fbuffer(0, tl_col, tl_row, br_col, br_row, 0, attribute);
+    fb_scroll_tbuffer(0, tl_col, tl_row, br_col, br_row, 0, attribute);
+}
+
+/*------------------------------------------------
+ * fb_con_set_region()
+ *
+ *  Set the scroll region of the text console,
+ *  the region is reset to the full page on a mode change.
+ *
+ * param:  top and bottom lines of the region
+ * return: none
+ *
+ */
+void fb_con_set_region(int top_row, int bottom_row)
+{
+    if ( active_emulation == -1 )
+        return;
+
+    if ( bottom_row >= graphics_mode[active_emulation].rows )
+        bottom_row = graphics_mode[active_emulation].rows - 1;
+
+    if ( top_row < 0 || top_row >= bottom_row )
+        return;
+
+    con_top_row = top_row;
+    con_bottom_row = bottom_row;
+}
+
+/*------------------------------------------------
+ * fb_con_get_region()
+ *
+ *  Get the scroll region of the text console.
+ *
+ * param:  pointers to top and bottom lines of the region
+ * return: none
+ *
+ */
+void fb_con_get_region(int *top_row, int *bottom_row)
+{
+    *top_row = con_top_row;
+    *bottom_row = con_bottom_row;
+}
+
+/*------------------------------------------------
+ * fb_con_set_cursor()
+ *
+ *  Move the text cursor, the position is clipped to the page.
+ *  Moving the cursor cancels a deferred wrap.
+ *
+ * param:  column and row
+ * return: none
+ *
+ */
+void fb_con_set_cursor(int column, int row)
+{
+    if ( active_emulation == -1 )
+        return;
+
+    if ( column < 0 )
+        column = 0;
+    else if ( column >= graphics_mode[active_emulation].cols )
+        column = graphics_mode[active_emulation].cols - 1;
+
+    if ( row < 0 )
+        row = 0;
+    else if ( row >= graphics_mode[active_emulation].rows )
+        row = graphics_mode[active_emulation].rows - 1;
+
+    cursor_column = column;
+    cursor_row = row;
+    con_wrap_pending = 0;
+}
+
+/*------------------------------------------------
+ * fb_con_get_cursor()
+ *
+ *  Get the text cursor position.
+ *
+ * param:  pointers to column and row
+ * return: none
+ *
+ */
+void fb_con_get_cursor(int *column, int *row)
+{
+    *column = cursor_column;
+    *row = cursor_row;
+}
+
+/*------------------------------------------------
+ * fb_con_get_info()
+ *
+ *  Get the text geometry of the active mode.
+ *
+ * param:  pointers to columns, rows, and monochrome flag
+ * return: 0 if no error, -1 if not initialized
+ *
+ */
+int fb_con_get_info(int *columns, int *rows, int *mono)
+{
+    if ( active_emulation == -1 )
+        return -1;
+
+    *columns = graphics_mode[active_emulation].cols;
+    *rows = graphics_mode[active_emulation].rows;
+    *mono = (active_emulation == 7 || active_emulation == 9);
+
+    return 0;
+}
+
+/*------------------------------------------------
+ * fb_put_pixel()
+ *
+ *  Put a pixel on a graphics-mode screen.
+ *  The pixel is written to the video memory shadow, and
+ *  an XOR is done with the video memory pixel value.
+ *
+ * param:  page number, pixel color, x and y coordinates
+ * return: none
+ *
+ */
+void fb_put_pixel(int page, uint8_t color, uint16_t x, uint16_t y)
+{
+    uint8_t     c;
+
+    if (  graphics_mode[active_emulation].mode != MODE_GR )
+    {
+        debug(DB_ERR, "%s: invalid mode\n", __FUNCTION__);
+        return;
+    }
+
+    if ( x >= var_info.xres || y >= var_info.yres )
+        return;
+
+    c = fb_plane_set(x, y, color);
+
+    if ( plane->bpp == 8 )
+        fb_draw_pixel(page, x, y, c);
+    else
+        fb_draw_pixel(page, x, y, plane_colors[c]);
+}
+
+/*------------------------------------------------
+ * fb_get_pixel()
+ *
+ *  Get a pixel's color value from a graphics-mode screen.
+ *  The value is read from the video memory shadow and not from the frame buffer.
+ *
+ * param:  page number, x and y coordinates
+ * return: send color value through UART
+ *
+ */
+void fb_get_pixel(int page, uint16_t x, uint16_t y)
+{
+    uint8_t color = 0;
+
+    // range checks
+    if ( plane == 0 ||
+         page >= graphics_mode[active_emulation].pages ||
+         x >= var_info.xres ||
+         y >= var_info.yres )
+    {
+        debug(DB_ERR, "%s: invalid mode, or page, or pixel position\n", __FUNCTION__);
+        color = 0;
+    }
+    else
+    {
+        // Get the pixel's value from the video memory shadow
+        color = fb_plane_get(x, y);
+    }
+
+    uart_send(color);
+}
+
+/*------------------------------------------------
+ * fb_draw_line()
+ *
+ *  Draw a line between two points with the Bresenham algorithm.
+ *  Horizontal lines are drawn as spans. Points outside of the screen are clipped.
+ *
+ * param:  page number, pixel color with XOR in bit 7, end point coordinates
+ * return: none
+ *
+ */
+void fb_draw_line(int page, uint8_t color, int x0, int y0, int x1, int y1)
+{
+    int     dx, dy, sx, sy, err, e2;
+
+    if ( plane == 0 || page >= graphics_mode[active_emulation].pages )
+    {
+        debug(DB_ERR, "%s: invalid mode or page\n", __FUNCTION__);
+        return;
+    }
+
+    if ( y0 == y1 )
+    {
+        fb_draw_span(page, color, x0, x1, y0);
+        return;
+    }
+
+    dx = (x1 > x0) ? (x1 - x0) : (x0 - x1);
+    dy = (y1 > y0) ? (y0 - y1) : (y1 - y0);
+    sx = (x0 < x1) ? 1 : -1;
+    sy = (y0 < y1) ? 1 : -1;
+    err = dx + dy;
+
+    while ( 1 )
+    {
+        if ( x0 >= 0 && y0 >= 0 )
+            fb_put_pixel(page, color, x0, y0);
+
+        if ( x0 == x1 && y0 == y1 )
+            break;
+
+        e2 = err << 1;
+        if ( e2 >= dy )
+        {
+            err += dy;
+            x0 += sx;
+        }
+        if ( e2 <= dx )
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_draw_rect()
+ *
+ *  Draw an outlined or a filled rectangle.
+ *  With XOR every pixel is changed only once, including the corners.
+ *
+ * param:  page number, pixel color with XOR in bit 7,
+ *         coordinates of two opposite corners, 1=filled 0=outline
+ * return: none
+ *
+ */
+void fb_draw_rect(int page, uint8_t color, int x0, int y0, int x1, int y1, int fill)
+{
+    int     y, t;
+
+    if ( plane == 0 || page >= graphics_mode[active_emulation].pages )
+    {
+        debug(DB_ERR, "%s: invalid mode or page\n", __FUNCTION__);
+        return;
+    }
+
+    if ( y0 > y1 )
+    {
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    if ( fill )
+    {
+        for ( y = y0; y <= y1; y++ )
+            fb_draw_span(page, color, x0, x1, y);
+    }
+    else
+    {
+        fb_draw_span(page, color, x0, x1, y0);
+        if ( y1 != y0 )
+            fb_draw_span(page, color, x0, x1, y1);
+
+        for ( y = y0 + 1; y < y1; y++ )
+        {
+            if ( y < 0 )
+                continue;
+
+            if ( x0 >= 0 )
+                fb_put_pixel(page, color, x0, y);
+            if ( x1 != x0 && x1 >= 0 )
+                fb_put_pixel(page, color, x1, y);
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_draw_span()
+ *
+ *  Draw a horizontal span of pixels.
+ *  The span is filled a video memory byte at a time, with masks for
+ *  partial bytes at the ends, and the changed bytes are then
+ *  converted to the frame buffer with word writes.
+ *
+ * param:  page number, pixel color with XOR in bit 7, end columns and row
+ * return: none
+ *
+ */
+void fb_draw_span(int page, uint8_t color, int x0, int x1, int y)
+{
+    int         t, first, last, offset, first_shift, last_shift;
+    uint8_t     c, fill, mask;
+
+    if ( plane == 0 || page >= graphics_mode[active_emulation].pages )
+    {
+        debug(DB_ERR, "%s: invalid mode or page\n", __FUNCTION__);
+        return;
+    }
+
+    if ( x0 > x1 )
+    {
+        t = x0; x0 = x1; x1 = t;
+    }
+
+    // clip to the screen
+    if ( y < 0 || y >= var_info.yres || x1 < 0 || x0 >= var_info.xres )
+        return;
+
+    if ( x0 < 0 )
+        x0 = 0;
+    if ( x1 >= var_info.xres )
+        x1 = var_info.xres - 1;
+
+    // replicate the pixel value to all pixels of a byte
+    c = color & ~FB_XOR_PIXEL;
+    if ( plane->bpp == 8 )
+        fill = color;
+    else if ( plane->bpp == 1 )
+        fill = (c != 0) ? 0xff : 0;
+    else
+        fill = (c & 0x03) * 0x55;
+
+    first = fb_plane_pixel(x0, y, &first_shift);
+    last = fb_plane_pixel(x1, y, &last_shift);
+
+    for ( offset = first; offset <= last; offset++ )
+    {
+        mask = 0xff;
+        if ( offset == first )
+            mask &= (uint8_t)((1 << (first_shift + plane->bpp)) - 1);
+        if ( offset == last )
+            mask &= (uint8_t)(0xff << last_shift);
+
+        if ( (color & FB_XOR_PIXEL) && plane->bpp != 8 )
+            vram[offset] ^= (fill & mask);
+        else
+            vram[offset] = (vram[offset] & ~mask) | (fill & mask);
+    }
+
+    fb_plane_update(first, last - first + 1);
+}
+
+/*------------------------------------------------
+ * fb_copy_rect()
+ *
+ *  Copy a rectangle of pixels to another position on the page.
+ *  Source and destination may overlap. The rows are copied in an order
+ *  that does not overwrite source rows before they are read, and each
+ *  row goes through a line buffer.
+ *
+ * param:  page number, XOR in bit 7,
+ *         source rectangle corners, top left corner of destination
+ * return: none
+ *
+ */
+void fb_copy_rect(int page, uint8_t flags, int x0, int y0, int x1, int y1, int dest_x, int dest_y)
+{
+    static uint8_t line_buffer[VRAM_LINE_PIX];
+
+    int         t, w, h, i, row, step, first, last, shift;
+
+    if ( plane == 0 || page >= graphics_mode[active_emulation].pages )
+    {
+        debug(DB_ERR, "%s: invalid mode or page\n", __FUNCTION__);
+        return;
+    }
+
+    if ( x0 > x1 )
+    {
+        t = x0; x0 = x1; x1 = t;
+    }
+    if ( y0 > y1 )
+    {
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    // clip the source to the screen
+    if ( x0 < 0 )
+    {
+        dest_x -= x0;
+        x0 = 0;
+    }
+    if ( y0 < 0 )
+    {
+        dest_y -= y0;
+        y0 = 0;
+    }
+    if ( x1 >= var_info.xres )
+        x1 = var_info.xres - 1;
+    if ( y1 >= var_info.yres )
+        y1 = var_info.yres - 1;
+
+    // clip the destination to the screen
+    if ( dest_x < 0 )
+    {
+        x0 -= dest_x;
+        dest_x = 0;
+    }
+    if ( dest_y < 0 )
+    {
+        y0 -= dest_y;
+        dest_y = 0;
+    }
+
+    w = x1 - x0 + 1;
+    h = y1 - y0 + 1;
+    if ( (dest_x + w) > var_info.xres )
+        w = var_info.xres - dest_x;
+    if ( (dest_y + h) > var_info.yres )
+        h = var_info.yres - dest_y;
+
+    if ( w <= 0 || h <= 0 )
+        return;
+
+    // copy bottom up when moving down, so that source rows are read before they are overwritten
+    if ( dest_y > y0 )
+    {
+        row = h - 1;
+        step = -1;
+    }
+    else
+    {
+        row = 0;
+        step = 1;
+    }
+
+    for ( ; row >= 0 && row < h; row += step )
+    {
+        for ( i = 0; i < w; i++ )
+            line_buffer[i] = fb_plane_get(x0 + i, y0 + row);
+
+        for ( i = 0; i < w; i++ )
+            fb_plane_set(dest_x + i, dest_y + row, (plane->bpp == 8) ? line_buffer[i] : (line_buffer[i] | (flags & FB_XOR_PIXEL)));
+
+        first = fb_plane_pixel(dest_x, dest_y + row, &shift);
+        last = fb_plane_pixel(dest_x + w - 1, dest_y + row, &shift);
+        fb_plane_update(first, last - first + 1);
+    }
+}
+
+/*------------------------------------------------
+ * fb_copy_text()
+ *
+ *  Copy a window of character cells from one text page to another,
+ *  or to another position on the same page. Both the text page buffer
+ *  entries and the frame buffer pixels are copied, so nothing is redrawn.
+ *  Overlapping windows are copied in an order that reads every source
+ *  line before it is overwritten.
+ *
+ * param:  source page, destination page, source window in character coordinates,
+ *         destination top left corner
+ * return: none
+ *
+ */
+void fb_copy_text(int src_page, int dest_page,
+                  int tl_col, int tl_row, int br_col, int br_row,
+                  int dest_col, int dest_row)
+{
+    int         i, cols, rows, line_count, line_bytes, step;
+    int         text_page_size, cursor_was_drawn;
+    uint16_t   *tb_from, *tb_to;
+    uint8_t    *fb_from, *fb_to;
+
+    if ( graphics_mode[active_emulation].mode != MODE_TX ||
+         src_page >= graphics_mode[active_emulation].pages ||
+         dest_page >= graphics_mode[active_emulation].pages )
+    {
+        debug(DB_ERR, "%s: invalid mode or page\n", __FUNCTION__);
+        return;
+    }
+
+    // clip the window to the page at source and destination
+    if ( br_col >= graphics_mode[active_emulation].cols )
+        br_col = graphics_mode[active_emulation].cols - 1;
+    if ( br_row >= graphics_mode[active_emulation].rows )
+        br_row = graphics_mode[active_emulation].rows - 1;
+
+    cols = br_col - tl_col + 1;
+    rows = br_row - tl_row + 1;
+
+    if ( (dest_col + cols) > graphics_mode[active_emulation].cols )
+        cols = graphics_mode[active_emulation].cols - dest_col;
+    if ( (dest_row + rows) > graphics_mode[active_emulation].rows )
+        rows = graphics_mode[active_emulation].rows - dest_row;
+
+    if ( cols <= 0 || rows <= 0 )
+        return;
+
+    fb_touch_page(src_page);
+    fb_touch_page(dest_page);
+
+    text_page_size = graphics_mode[active_emulation].cols * graphics_mode[active_emulation].rows;
+    line_count = rows * font_h;
+    line_bytes = cols * font_w;
+
+    tb_from = &text_pages[src_page * text_page_size + tl_row * graphics_mode[active_emulation].cols + tl_col];
+    tb_to = &text_pages[dest_page * text_page_size + dest_row * graphics_mode[active_emulation].cols + dest_col];
+
+    fb_from = fbp + src_page * page_size + tl_row * font_h * var_info.pitch + tl_col * font_w;
+    fb_to = fbp + dest_page * page_size + dest_row * font_h * var_info.pitch + dest_col * font_w;
+
+    // copy bottom up when the destination is below the source
+    if ( tb_to > tb_from )
+    {
+        tb_from += (rows - 1) * graphics_mode[active_emulation].cols;
+        tb_to += (rows - 1) * graphics_mode[active_emulation].cols;
+        fb_from += (line_count - 1) * var_info.pitch;
+        fb_to += (line_count - 1) * var_info.pitch;
+        step = -1;
+    }
+    else
+    {
+        step = 1;
+    }
+
+    // the cursor cell must not be copied inverted
+    cursor_was_drawn = cursor_drawn;
+    fb_cursor_on_off(0);
+
+    for ( i = 0; i < rows; i++ )
+    {
+        memmove(tb_to, tb_from, cols * sizeof(uint16_t));
+        tb_from += step * graphics_mode[active_emulation].cols;
+        tb_to += step * graphics_mode[active_emulation].cols;
+    }
+
+    for ( i = 0; i < line_count; i++ )
+    {
+        memmove(fb_to, fb_from, line_bytes);
+        fb_from += step * var_info.pitch;
+        fb_to += step * var_info.pitch;
+    }
+
+    if ( cursor_was_drawn )
+        fb_cursor_on_off(1);
+}
+
+/*------------------------------------------------
+ * fb_mem_write()
+ *
+ *  Write a block of bytes into the video memory window shadow
+ *  and convert the changed bytes into frame buffer pixels.
+ *  The window offset is interpreted in the native memory layout
+ *  of the emulated card.
+ *
+ * param:  offset into the video memory window, source bytes and byte count
+ * return: none
+ *
+ */
+void fb_mem_write(int offset, uint8_t *data, int count)
+{
+    if ( offset < 0 || count <= 0 || (offset + count) > VRAM_SIZE )
+    {
+        debug(DB_ERR, "%s: invalid memory window offset %d or count %d\n", __FUNCTION__, offset, count);
+        return;
+    }
+
+    if ( active_emulation >= 0 && active_emulation <= 7 &&
+         graphics_mode[active_emulation].mode == MODE_TX )
+    {
+        fb_text_mem_write(offset, data, count);
+    }
+    else if ( plane )
+    {
+        fb_plane_write(offset, data, count);
+    }
+    else
+    {
+        debug(DB_ERR, "%s: memory window not supported in mode %d\n", __FUNCTION__, active_emulation);
+    }
+}
+
+/*------------------------------------------------
+ * fb_plane_write()
+ *
+ *  Write a block of bytes into the graphics mode video memory shadow.
+ *  Only runs of bytes that differ from the shadow are converted
+ *  into frame buffer pixels.
+ *
+ * param:  offset into the video memory window, source bytes and byte count
+ * return: none
+ *
+ */
+void fb_plane_write(int offset, uint8_t *data, int count)
+{
+    int     i, changed;
+
+    i = 0;
+    while ( i < count )
+    {
+        while ( i < count && vram[offset + i] == data[i] )
+            i++;
+
+        changed = i;
+        while ( i < count && vram[offset + i] != data[i] )
+        {
+            vram[offset + i] = data[i];
+            i++;
+        }
+
+        if ( i > changed )
+            fb_plane_update(offset + changed, i - changed);
+    }
+}
+
+/*------------------------------------------------
+ * fb_pix_write()
+ *
+ *  Write a block of pixels in the 256 color mode.
+ *  The pixels fill rows of 'width' pixels starting at x,y,
+ *  a single row when the byte count is not more than the width.
+ *  Rows are clipped at the right and bottom edges.
+ *
+ * param:  top left corner, block width, pixel bytes and byte count
+ * return: none
+ *
+ */
+void fb_pix_write(int x, int y, int width, uint8_t *data, int count)
+{
+    int     row_pixels, shift;
+
+    if ( plane == 0 || plane->bpp != 8 )
+    {
+        debug(DB_ERR, "%s: invalid mode\n", __FUNCTION__);
+        return;
+    }
+
+    if ( width <= 0 || x >= var_info.xres )
+        return;
+
+    row_pixels = width;
+    if ( (x + row_pixels) > var_info.xres )
+        row_pixels = var_info.xres - x;
+
+    while ( count > 0 && y < var_info.yres )
+    {
+        if ( row_pixels > count )
+            row_pixels = count;
+
+        fb_plane_write(fb_plane_pixel(x, y, &shift), data, row_pixels);
+
+        data += width;
+        count -= width;
+        y++;
+    }
+}
+
+/*------------------------------------------------
+ * fb_dac_write()
+ *
+ *  Load a range of the 256 color mode palette from VGA DAC colors
+ *  with 6-bit components, in one mailbox call.
+ *
+ * param:  first color index, red/green/blue triplets, color count
+ * return: none
+ *
+ */
+void fb_dac_write(int index, uint8_t *data, int count)
+{
+    int     i;
+
+    if ( plane == 0 || plane->bpp != 8 )
+    {
+        debug(DB_ERR, "%s: invalid mode\n", __FUNCTION__);
+        return;
+    }
+
+    if ( (index + count) > FB_PAL_SIZE )
+        count = FB_PAL_SIZE - index;
+
+    if ( count <= 0 )
+        return;
+
+    for ( i = 0; i < count; i++, data += 3 )
+        palette_bgr[index + i] = fb_dac_to_bgr(data[0], data[1], data[2]);
+
+    fb_palette_update(index, count);
+}
+
+/*------------------------------------------------
+ * fb_text_mem_write()
+ *
+ *  Write a block of bytes into the text mode video memory window.
+ *  The window holds pages of character and attribute byte pairs, with
+ *  a page stride of 2KB in 40 column modes and 4KB in 80 column modes.
+ *  The text page shadow is the video memory shadow, and only
+ *  character cells that changed are redrawn.
+ *
+ * param:  offset into the video memory window, source bytes and byte count
+ * return: none
+ *
+ */
+void fb_text_mem_write(int offset, uint8_t *data, int count)
+{
+    int         i, page, page_shift, page_cells, cell, text_offset;
+    uint16_t    attr_char, new_attr_char;
+    uint8_t     fg_color, bg_color;
+
+    page_cells = graphics_mode[active_emulation].cols * graphics_mode[active_emulation].rows;
+    page_shift = (graphics_mode[active_emulation].cols == 40) ? VRAM_TX_PAGE_40 : VRAM_TX_PAGE_80;
+
+    i = 0;
+    while ( i < count )
+    {
+        page = (offset + i) >> page_shift;
+        cell = ((offset + i) & ((1 << page_shift) - 1)) >> 1;
+
+        // Skip the unused tail of a page
+        if ( page >= graphics_mode[active_emulation].pages || cell >= page_cells )
+        {
+            i++;
+            continue;
+        }
+
+        fb_touch_page(page);
+
+        text_offset = page * page_cells + cell;
+        attr_char = text_pages[text_offset];
+
+        // Character byte on even offset followed by the attribute byte
+        if ( ((offset + i) & 1) == 0 )
+        {
+            new_attr_char = (attr_char & 0xff00) | data[i++];
+            if ( i < count )
+                new_attr_char = (new_attr_char & 0x00ff) | ((uint16_t)data[i++] << 8);
+        }
+        else
+        {
+            new_attr_char = (attr_char & 0x00ff) | ((uint16_t)data[i++] << 8);
+        }
+
+        if ( new_attr_char != attr_char )
+        {
+            text_pages[text_offset] = new_attr_char;
+            fb_text_colors((uint8_t)(new_attr_char >> 8), &fg_color, &bg_color);
+            fb_draw_char(page,
+                         cell % graphics_mode[active_emulation].cols,
+                         cell / graphics_mode[active_emulation].cols,
+                         (uint8_t)new_attr_char, fg_color, bg_color,
+                         (uint8_t)(new_attr_char >> 8), 0);
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_plane_update()
+ *
+ *  Convert a range of a graphics mode video memory window into
+ *  frame buffer pixels. The video memory is organized in interleaved
+ *  banks, bank 'n' of 'b' banks holds the scan lines 'n', 'n+b', 'n+2b' etc.
+ *  CGA uses two banks of 8KB, Hercules uses four.
+ *
+ * param:  offset into the video memory window and byte count
+ * return: none
+ *
+ */
+void fb_plane_update(int offset, int count)
+{
+    int         bank, bank_offset, line, column, run, i;
+    uint8_t    *src;
+    uint32_t   *pix;
+
+    while ( count > 0 )
+    {
+        bank = offset >> plane->bank_shift;
+        bank_offset = offset & ((1 << plane->bank_shift) - 1);
+        line = bank_offset / plane->bytes_per_line;
+        column = bank_offset - (line * plane->bytes_per_line);
+
+        // Convert the bytes that fall within this scan line
+        run = plane->bytes_per_line - column;
+        if ( run > count )
+            run = count;
+
+        // Skip the unused tail of a bank and banks outside of the layout
+        if ( line >= plane->lines_per_bank || bank >= (1 << plane->bank_bits) )
+        {
+            run = (1 << plane->bank_shift) - bank_offset;
+            if ( run > count )
+                run = count;
+        }
+        else
+        {
+            src = &vram[offset];
+            pix = (uint32_t*)(fbp + active_page * page_size +
+                              ((line << plane->bank_bits) + bank) * var_info.pitch +
+                              (column << plane->ppb_bits));
+
+            if ( plane->bpp == 8 )
+            {
+                memcpy(pix, src, run);
+            }
+            else if ( plane->bpp == 1 )
+            {
+                for ( i = 0; i < run; i++ )
+                {
+                    *pix++ = lut_1bpp[src[i]][0];
+                    *pix++ = lut_1bpp[src[i]][1];
+                }
+            }
+            else
+            {
+                for ( i = 0; i < run; i++ )
+                {
+                    *pix++ = lut_2bpp[src[i]];
+                }
+            }
+        }
+
+        offset += run;
+        count -= run;
+    }
+}
+
+/*------------------------------------------------
+ * fb_plane_pixel()
+ *
+ *  Locate a pixel in the graphics mode video memory.
+ *
+ * param:  x and y coordinates, pointer to pixel's bit shift within the byte
+ * return: video memory offset of the byte holding the pixel
+ *
+ */
+int fb_plane_pixel(uint16_t x, uint16_t y, int *pixel_shift)
+{
+    int     pixels_per_byte_bits;
+
+    pixels_per_byte_bits = plane->ppb_bits;
+    *pixel_shift = (((1 << pixels_per_byte_bits) - 1) - (x & ((1 << pixels_per_byte_bits) - 1))) * plane->bpp;
+
+    return ((y & ((1 << plane->bank_bits) - 1)) << plane->bank_shift) +
+           (y >> plane->bank_bits) * plane->bytes_per_line +
+           (x >> pixels_per_byte_bits);
+}
+
+/*------------------------------------------------
+ * fb_plane_set()
+ *
+ *  Set or XOR a pixel in the graphics mode video memory shadow.
+ *
+ * param:  x and y coordinates, pixel color with XOR in bit 7
+ * return: resulting pixel value
+ *
+ */
+uint8_t fb_plane_set(uint16_t x, uint16_t y, uint8_t color)
+{
+    uint8_t     c, pixel_mask;
+    int         pixel_shift, vram_offset;
+
+    // the 256 color mode uses all color bits and has no XOR
+    if ( plane->bpp == 8 )
+    {
+        vram_offset = fb_plane_pixel(x, y, &pixel_shift);
+        vram[vram_offset] = color;
+        return color;
+    }
+
+    c = color & ~FB_XOR_PIXEL;              // isolate color
+    pixel_mask = (1 << plane->bpp) - 1;
+
+    if ( plane->bpp == 1 )
+        c = (c != 0) ? 1 : 0;
+    else
+        c &= pixel_mask;
+
+    vram_offset = fb_plane_pixel(x, y, &pixel_shift);
+
+    if ( color & FB_XOR_PIXEL )
+        vram[vram_offset] ^= (c << pixel_shift);
+    else
+        vram[vram_offset] = (vram[vram_offset] & ~(pixel_mask << pixel_shift)) | (c << pixel_shift);
+
+    return (vram[vram_offset] >> pixel_shift) & pixel_mask;
+}
+
+/*------------------------------------------------
+ * fb_plane_get()
+ *
+ *  Read a pixel from the graphics mode video memory shadow.
+ *
+ * param:  x and y coordinates
+ * return: pixel value
+ *
+ */
+uint8_t fb_plane_get(uint16_t x, uint16_t y)
+{
+    int         pixel_shift, vram_offset;
+
+    vram_offset = fb_plane_pixel(x, y, &pixel_shift);
+
+    return (vram[vram_offset] >> pixel_shift) & ((1 << plane->bpp) - 1);
+}
+
+/*------------------------------------------------
+ * fb_plane_char()
+ *
+ *  Draw a character into the graphics mode video memory shadow
+ *  with a transparent background, and convert the character cell's
+ *  video memory bytes into frame buffer pixels.
+ *
+ * param:  character column and row, character, pixel value
+ * return: none
+ *
+ */
+void fb_plane_char(uint8_t x, uint8_t y, uint8_t c, uint8_t pixel_value)
+{
+    int         row, col, px, py, vram_offset, shift;
+    uint8_t     bit_pattern;
+
+    // adjust for monochrome mode
+    if ( plane->bpp == 1 )
+        pixel_value = ( pixel_value > 0 ) ? 1 : 0;
+    else if ( plane->bpp == 2 )
+        pixel_value &= 0x03;
+
+    px = x * font_w;
+    if ( (px + 7) >= var_info.xres )
+        return;
+
+    for ( row = 0; row < font_h; row++ )
+    {
+        py = y * font_h + row;
+        if ( py >= var_info.yres )
+            break;
+
+        bit_pattern = font_ram[(int)c * FONT_ROWS + row];
+        if ( bit_pattern == 0 )
+            continue;
+
+        for ( col = 0; col < 8; col++ )
+        {
+            if ( bit_pattern & (0x80 >> col) )
+                fb_plane_set(px + col, py, pixel_value);
+        }
+
+        vram_offset = fb_plane_pixel(px, py, &shift);
+        fb_plane_update(vram_offset, plane->bpp);
+    }
+}
+
+/*------------------------------------------------
+ * fb_plane_scroll()
+ *
+ *  Scroll a window of the graphics mode video memory shadow
+ *  and convert the window's scan lines into frame buffer pixels.
+ *  The frame buffer is not read.
+ *
+ * param:  dir           up=0 or down=1
+ *         tl_ , br_     window to scroll in character coordinates
+ *         count         scroll count in character rows, 0 clears the window
+ *         attrib        pixel value to fill in cleared rows
+ * return: none
+ *
+ */
+void fb_plane_scroll(uint8_t dir, uint8_t tl_col, uint8_t tl_row, uint8_t br_col, uint8_t br_row, uint8_t count, uint8_t attrib)
+{
+    int         i, line, lines, top, scroll_lines, bytes, shift, from, to;
+    uint8_t     fill;
+
+    if ( br_col >= graphics_mode[active_emulation].cols )
+        br_col = graphics_mode[active_emulation].cols - 1;
+    if ( br_row >= graphics_mode[active_emulation].rows )
+        br_row = graphics_mode[active_emulation].rows - 1;
+
+    if ( br_col < tl_col || br_row < tl_row )
+        return;
+
+    // a character column is 8 pixels, one byte in 1-bpp, two bytes in 2-bpp and eight in 8-bpp
+    bytes = (br_col - tl_col + 1) * plane->bpp;
+    top = tl_row * font_h;
+    lines = (br_row - tl_row + 1) * font_h;
+
+    scroll_lines = count * font_h;
+    if ( count == 0 || scroll_lines > lines )
+        scroll_lines = lines;
+
+    if ( plane->bpp == 8 )
+        fill = attrib;
+    else if ( plane->bpp == 1 )
+        fill = (attrib > 0) ? 0xff : 0;
+    else
+        fill = (attrib & 0x03) * 0x55;
+
+    for ( i = 0; i < lines; i++ )
+    {
+        line = (dir == 0) ? (top + i) : (top + lines - 1 - i);
+        to = fb_plane_pixel(tl_col * font_w, line, &shift);
+
+        if ( i < (lines - scroll_lines) )
+        {
+            from = fb_plane_pixel(tl_col * font_w, (dir == 0) ? (line + scroll_lines) : (line - scroll_lines), &shift);
+            memcpy(&vram[to], &vram[from], bytes);
+        }
+        else
+        {
+            memset(&vram[to], fill, bytes);
+        }
+
+        fb_plane_update(to, bytes);
+    }
+}
+
+/*------------------------------------------------
+ * fb_build_plane_luts()
+ *
+ *  Set up the frame buffer colors of the graphics mode video memory
+ *  pixel values, and build the byte to pixels expansion tables.
+ *  The frame buffer colors are the indexes of the mode's palette bank.
+ *  Each table entry holds 4 frame buffer pixels per word, and
+ *  the most significant bits are the left most pixel.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void fb_build_plane_luts(void)
+{
+    int         byte, pix;
+
+    if ( plane == 0 )
+        return;
+
+    if ( plane->bpp == 8 )
+    {
+        // the pixel value is the frame buffer color, no tables needed
+        plane_colors[0] = 0;
+    }
+    else if ( plane->bpp == 2 )
+    {
+        for ( pix = 0; pix < 4; pix++ )
+            plane_colors[pix] = FB_PAL_GR4 + pix;
+
+        for ( byte = 0; byte < 256; byte++ )
+        {
+            lut_2bpp[byte] = 0;
+            for ( pix = 0; pix < 4; pix++ )
+                lut_2bpp[byte] |= (uint32_t)plane_colors[(byte >> (6 - pix * 2)) & 0x03] << (pix * 8);
+        }
+    }
+    else
+    {
+        plane_colors[0] = FB_PAL_GR2;
+        plane_colors[1] = FB_PAL_GR2 + 1;
+
+        for ( byte = 0; byte < 256; byte++ )
+        {
+            lut_1bpp[byte][0] = 0;
+            lut_1bpp[byte][1] = 0;
+            for ( pix = 0; pix < 8; pix++ )
+                lut_1bpp[byte][pix >> 2] |= (uint32_t)plane_colors[(byte >> (7 - pix)) & 0x01] << ((pix & 3) * 8);
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_build_palette_banks()
+ *
+ *  Build the VideoCore palette from the CGA colors.
+ *  The 4 color graphics bank holds the background and the
+ *  three colors of the selected CGA palette, and the 2 color
+ *  graphics bank holds the monochrome colors of the active mode.
+ *  Mode 13h uses the whole palette as the VGA DAC.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void fb_build_palette_banks(void)
+{
+    int     pix;
+
+    if ( plane && plane->bpp == 8 )
+    {
+        fb_build_vga_dac();
+        return;
+    }
+
+    for ( pix = 0; pix < 16; pix++ )
+        palette_bgr[FB_PAL_TEXT + pix] = cga_palette_bgr[pix];
+
+    fb_build_blink_bank(blink_visible);
+
+    palette_bgr[FB_PAL_GR4] = cga_palette_bgr[FB_BLACK];
+    for ( pix = 1; pix < 4; pix++ )
+        palette_bgr[FB_PAL_GR4 + pix] = cga_palette_bgr[((pix << 1) + palette) & 0x07];
+
+    if ( active_emulation == 8 )
+    {
+        palette_bgr[FB_PAL_GR2] = cga_palette_bgr[VGA_DEF_HERC_BG];
+        palette_bgr[FB_PAL_GR2 + 1] = cga_palette_bgr[VGA_DEF_HERC_FG];
+    }
+    else
+    {
+        palette_bgr[FB_PAL_GR2] = cga_palette_bgr[FB_BLACK];
+        palette_bgr[FB_PAL_GR2 + 1] = cga_palette_bgr[FB_WHITE];
+    }
+}
+
+/*------------------------------------------------
+ * fb_build_vga_dac()
+ *
+ *  Load the palette with the VGA BIOS default DAC colors of mode 13h:
+ *  the 16 CGA colors, a 16 step gray scale, 9 rings of 24 hues in three
+ *  intensities and three saturations, and 8 black entries.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void fb_build_vga_dac(void)
+{
+    static const uint8_t gray[16] =
+        { 0x00, 0x05, 0x08, 0x0b, 0x0e, 0x11, 0x14, 0x18, 0x1c, 0x20, 0x24, 0x28, 0x2d, 0x32, 0x38, 0x3f };
+    static const uint8_t ramp[9][5] =
+    {
+        {0x00, 0x10, 0x1f, 0x2f, 0x3f}, {0x1f, 0x27, 0x2f, 0x37, 0x3f}, {0x2d, 0x31, 0x36, 0x3a, 0x3f},
+        {0x00, 0x07, 0x0e, 0x15, 0x1c}, {0x0e, 0x11, 0x15, 0x18, 0x1c}, {0x14, 0x16, 0x18, 0x1a, 0x1c},
+        {0x00, 0x04, 0x08, 0x0c, 0x10}, {0x08, 0x0a, 0x0c, 0x0e, 0x10}, {0x0b, 0x0c, 0x0d, 0x0f, 0x10},
+    };
+
+    int         i, ring, hue, step;
+    uint8_t     r, g, b, lo, hi, up, down;
+
+    for ( i = 0; i < 16; i++ )
+        palette_bgr[i] = cga_palette_bgr[i];
+
+    for ( i = 0; i < 16; i++ )
+        palette_bgr[16 + i] = fb_dac_to_bgr(gray[i], gray[i], gray[i]);
+
+    /* Each ring goes around the color wheel from blue, through
+     * magenta, red, yellow, green and cyan, in six segments of four steps
+     */
+    for ( ring = 0; ring < 9; ring++ )
+    {
+        lo = ramp[ring][0];
+        hi = ramp[ring][4];
+
+        for ( hue = 0; hue < 24; hue++ )
+        {
+            step = hue & 0x03;
+            up = ramp[ring][step];
+            down = ramp[ring][4 - step];
+
+            switch ( hue >> 2 )
+            {
+                case 0: r = up;   g = lo;   b = hi;   break;
+                case 1: r = hi;   g = lo;   b = down; break;
+                case 2: r = hi;   g = up;   b = lo;   break;
+                case 3: r = down; g = hi;   b = lo;   break;
+                case 4: r = lo;   g = hi;   b = up;   break;
+                default: r = lo;  g = down; b = hi;
+            }
+
+            palette_bgr[32 + ring * 24 + hue] = fb_dac_to_bgr(r, g, b);
+        }
+    }
+
+    for ( i = 248; i < FB_PAL_SIZE; i++ )
+        palette_bgr[i] = 0;
+}
+
+/*------------------------------------------------
+ * fb_dac_to_bgr()
+ *
+ *  Convert a VGA DAC color with 6-bit components into a palette entry.
+ *
+ * param:  red, green, and blue 0 to 63
+ * return: palette entry in BGR format
+ *
+ */
+uint32_t fb_dac_to_bgr(uint8_t r, uint8_t g, uint8_t b)
+{
+    r &= 0x3f;
+    g &= 0x3f;
+    b &= 0x3f;
+
+    return ((uint32_t)((b << 2) | (b >> 4)) << 16) |
+           ((uint32_t)((g << 2) | (g >> 4)) << 8) |
+           (uint32_t)((r << 2) | (r >> 4));
+}
+
+/*------------------------------------------------
+ * fb_build_blink_bank()
+ *
+ *  Build the blink palette bank. The bank has an entry for each
+ *  combination of a background color 0 to 7 and a foreground color 0 to 15,
+ *  which holds the foreground color when blinking characters are visible
+ *  or the background color when they are not.
+ *
+ * param:  1= blinking characters visible, 0= hidden
+ * return: none
+ *
+ */
+void fb_build_blink_bank(int visible)
+{
+    int     fg, bg;
+
+    for ( bg = 0; bg < 8; bg++ )
+    {
+        for ( fg = 0; fg < 16; fg++ )
+        {
+            palette_bgr[FB_PAL_BLINK + (bg << 4) + fg] = cga_palette_bgr[visible ? fg : bg];
+        }
+    }
+}
+
+/*------------------------------------------------
+ * fb_palette_update()
+ *
+ *  Load a range of palette entries into the VideoCore palette.
+ *  The change is immediately visible on all pixels using these entries.
+ *
+ * param:  first palette entry and entry count
+ * return: 0 if no error,
+ *        -1 if mailbox call failed
+ *
+ */
+int fb_palette_update(int offset, int count)
+{
+    bcm2835_mailbox_init();
+    bcm2835_mailbox_add_tag(TAG_FB_SET_PALETTE, offset, count, (uint32_t)(uintptr_t)&palette_bgr[offset]);
+    if ( !fb_mailbox_process(TAG_FB_SET_PALETTE) )
+    {
+        debug(DB_ERR, "%s: bcm2835_mailbox_process() failed\n", __FUNCTION__);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------
+ * fb_mailbox_process()
+ *
+ *  Send the mailbox property buffer to the VideoCore GPU,
+ *  recorded as a mailbox event span.
+ *
+ * param:  tag identifying the call in the event trace
+ * return: buffer address of response if successful, NULL- otherwise
+ *
+ */
+uint32_t *fb_mailbox_process(uint32_t tag)
+{
+    uint32_t   *result;
+
+    event_begin(EVENT_MAILBOX, tag);
+    result = bcm2835_mailbox_process();
+    event_end(EVENT_MAILBOX, tag);
+
+    return result;
 }
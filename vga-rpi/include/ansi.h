@@ -0,0 +1,23 @@
+/********************************************************************
+ * ansi.h
+ *
+ *  ANSI/VT100 terminal emulation on the text console.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#ifndef __ansi_h__
+#define __ansi_h__
+
+#include    <stdint.h>
+
+#include    "uart.h"
+
+/********************************************************************
+ * Function prototypes
+ *
+ */
+void ansi_emul(cmd_param_t*, uint8_t*, int);
+
+#endif      /* __ansi_h__ */
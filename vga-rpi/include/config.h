@@ -13,6 +13,7 @@
 
 #include    "bcm2835.h"
 #include    "auxuart.h"
+#include    "pmu.h"
 
 #include    "fb.h"
 
@@ -28,17 +29,62 @@
 #define     VGA_DEF_COLR_FG_TXT     FB_GRAY         // default text mode foreground in color modes
 #define     VGA_DEF_COLR_BG_TXT     FB_BLACK        // default text mode background in color modes
 
+#define     VGA_DEF_HERC_FG         FB_WHITE        // Hercules graphics mode foreground (pixel 'on')
+#define     VGA_DEF_HERC_BG         FB_BLACK        // Hercules graphics mode background (pixel 'off')
+
 /********************************************************************
  *  UART
  */
-#define     UART_TEST_CMD       0                   // *** make sure this is '0' for non-test setup ***
+#ifndef     UART_TEST_CMD
+#define     UART_TEST_CMD       0                   // *** make sure this is '0' for non-test setup, '1' runs the workload generator ***
+#endif
 
 #define     UART_BAUD           BAUD_57600
 #define     UART_RTS            RPI_V2_GPIO_P1_11   // GPIO17 pin.11
 
+/********************************************************************
+ *  Performance monitor events counted per command (trace statistics 'ev0' and 'ev1')
+ */
+#define     VGA_PMU_EVENT0      PMU_EVT_DCACHE_MISS
+#define     VGA_PMU_EVENT1      PMU_EVT_BRANCH_MISS
+#define     VGA_CPU_MHZ         700                 // cycle counter ticks per uSec
+
+#ifndef     VGA_IRQ_STATS
+#define     VGA_IRQ_STATS       0                   // 1=time interrupt dispatch, handlers and critical sections in PMU cycles for profiling builds
+#endif
+
+/********************************************************************
+ *  Workload generator (UART_TEST_CMD = 1)
+ */
+#define     WORKLOAD_COMMANDS   2000                // commands per test, scrolls, clears and mode switches use fewer
+#define     WORKLOAD_SEED       0x2545f491          // pseudo random sequence seed, must not be 0
+
+/********************************************************************
+ *  Event trace
+ */
+#ifndef     EVENT_TRACE
+#define     EVENT_TRACE         0                   // 1=record trace events in the event ring for profiling builds, 0=remove them at compile time
+#endif
+#define     EVENT_CLOCK_CYCLES  0                   // 1=time stamp with the PMU cycle counter, 0=System Timer uSec
+
+/********************************************************************
+ *  Main loop load monitor
+ */
+#define     MONITOR_INTERVAL    1000000             // uSec of a busy/idle accounting interval
+#define     MONITOR_STALL       10000               // uSec, command dispatches or idle work at or above this are stalls
+#define     MONITOR_STALL_LED   1                   // 1=light the ACT LED after a stall, 0=no alert
+#define     MONITOR_LED_TIME    250000              // uSec the ACT LED stays on after a stall
+
+/********************************************************************
+ *  Profiler
+ */
+#define     PROFILE_INTERVAL    250                 // uSec between PC samples, System Timer compare 3
+
 /********************************************************************
  *  Debug
  */
-#define     UTIL_DEF_DBG_LVL    3                   // 0=quiet, 1=errors, 2=information, 3=verbose
+#define     UTIL_DEF_DBG_LVL    2                   // 0=quiet, 1=errors, 2=information, 3=verbose (logs every packet)
+#define     UTIL_LOG_LEVEL      3                   // debug messages compiled in, same levels as above
+#define     UTIL_LOG_IDLE_DRAIN 0                   // 1=print the log ring as text in idle time, 0=only on request
 
 #endif  /* __config_h__ */
@@ -0,0 +1,62 @@
+/********************************************************************
+ * event.h
+ *
+ *  Event trace of spans and instant events in a RAM ring.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#ifndef __event_h__
+#define __event_h__
+
+#include    <stdint.h>
+
+#include    "config.h"
+
+#define     EVENT_MAGIC         0x45414756  // "VGAE" little endian, event dump header
+#define     EVENT_VERSION       1
+
+/* Event phases, same as the Chrome trace 'B', 'E' and 'i' phases
+ */
+typedef enum
+{
+    EVENT_BEGIN   = 0,
+    EVENT_END     = 1,
+    EVENT_INSTANT = 2,
+} event_phase_t;
+
+/* Event IDs and their payloads, tools/vgaevents.py has the same list
+ */
+typedef enum
+{
+    EVENT_COMMAND = 0,                      // span, command dispatch, payload is the command byte
+    EVENT_IDLE    = 1,                      // span, no commands to process
+    EVENT_PACKET  = 2,                      // instant, command packet queued, payload is the command byte
+    EVENT_IRQ     = 3,                      // span, interrupt handler, payload is the interrupt source
+    EVENT_MAILBOX = 4,                      // span, mailbox property call, payload is the low 16 bits of a tag
+} event_id_t;
+
+/* Events are recorded from the main loop, interrupt handlers are
+ * recorded through the IRQ dispatch monitor.
+ * Events are removed at compile time when EVENT_TRACE is 0.
+ */
+#if EVENT_TRACE
+#define     event_begin(id, payload)    event_record(EVENT_BEGIN, (id), (payload))
+#define     event_end(id, payload)      event_record(EVENT_END, (id), (payload))
+#define     event_instant(id, payload)  event_record(EVENT_INSTANT, (id), (payload))
+#else
+#define     event_begin(id, payload)
+#define     event_end(id, payload)
+#define     event_instant(id, payload)
+#endif
+
+/********************************************************************
+ * Function prototypes
+ *
+ */
+void event_init(void);
+void event_record(event_phase_t, event_id_t, uint32_t);
+void event_send(void);
+
+#endif      /* __event_h__ */
@@ -39,13 +39,28 @@
 #define     FB_ATTR_HIGHINTUL   0x09    // high intensity underline
 #define     FB_ATTR_HIGHINT     0x0f    // high intensity
 #define     FB_ATTR_INV         0x70    // inverse
+#define     FB_ATTR_BLINK       0x80    // blink, in monochrome and color modes
 
 /********************************************************************
  * Function prototypes
  *
  */
 int  fb_init(int);
-void fb_emul(cmd_param_t*);
+void fb_emul(cmd_param_t*, uint8_t*, int);
 void fb_cursor_blink();
+void fb_idle(void);
+uint32_t fb_frame_hash(void);
+int  fb_get_mode_info(int, int*, int*, int*, int*);
+
+/* Text console interface for the terminal emulator
+ */
+void fb_con_write(uint8_t, uint8_t, uint8_t*, int, int);
+void fb_con_scroll(int, int, int, int, uint8_t);
+void fb_con_erase(int, int, int, int, uint8_t);
+void fb_con_set_region(int, int);
+void fb_con_get_region(int*, int*);
+void fb_con_set_cursor(int, int);
+void fb_con_get_cursor(int*, int*);
+int  fb_con_get_info(int*, int*, int*);
 
 #endif  /* __fb_h__ */
@@ -0,0 +1,30 @@
+/********************************************************************
+ * monitor.h
+ *
+ *  Main loop load monitor and stall detector.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#ifndef __monitor_h__
+#define __monitor_h__
+
+#include    <stdint.h>
+
+#define     MONITOR_MAGIC       0x4D414756  // "VGAM" little endian, load monitor query reply header
+#define     MONITOR_VERSION     2
+
+#define     MONITOR_NO_CMD      -1          // deferred work of a loop iteration without a command
+
+/********************************************************************
+ * Function prototypes
+ *
+ */
+void monitor_init(void);
+void monitor_begin(void);
+void monitor_end(int);
+void monitor_loop(void);
+void monitor_send(void);
+
+#endif      /* __monitor_h__ */
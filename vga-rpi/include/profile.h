@@ -0,0 +1,31 @@
+/********************************************************************
+ * profile.h
+ *
+ *  Sampling profiler of the interrupted PC on a System Timer interrupt.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#ifndef __profile_h__
+#define __profile_h__
+
+#include    <stdint.h>
+
+#include    "uart.h"
+
+#define     PROFILE_MAGIC       0x50414756  // "VGAP" little endian, profile dump header
+#define     PROFILE_VERSION     1
+
+#define     PROFILE_STOP        0           // profile command actions
+#define     PROFILE_START       1
+#define     PROFILE_DUMP        2
+
+/********************************************************************
+ * Function prototypes
+ *
+ */
+void profile_init(void);
+void profile_control(cmd_param_t*);
+
+#endif      /* __profile_h__ */
@@ -0,0 +1,49 @@
+/********************************************************************
+ * trace.h
+ *
+ *  Command stream capture, replay and command cost statistics.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#ifndef __trace_h__
+#define __trace_h__
+
+#include    <stdint.h>
+
+#include    "uart.h"
+
+#define     TRACE_MAGIC         0x54414756  // "VGAT" little endian, trace dump header
+#define     TRACE_STATS_MAGIC   0x53414756  // "VGAS" little endian, statistics query reply header
+#define     TRACE_IRQ_MAGIC     0x49414756  // "VGAI" little endian, interrupt statistics query reply header
+#define     TRACE_VERSION       1
+
+#define     TRACE_STOP          0           // trace command actions
+#define     TRACE_START         1
+#define     TRACE_DUMP          2
+#define     TRACE_REPLAY        3
+#define     TRACE_REPORT        4
+
+#define     TRACE_FLAG_STAMPS   0x01        // record a time stamp at the end of every packet
+
+/********************************************************************
+ * Function prototypes
+ *
+ */
+void trace_control(cmd_param_t*);
+void trace_rx_byte(uint8_t);
+void trace_packet(int);
+void trace_cmd_start(void);
+void trace_cmd(int);
+void trace_replay(uint8_t*, int);
+void trace_replay_done(void);
+void trace_idle(void);
+void trace_get_totals(uint32_t*, uint32_t*);
+uint32_t trace_rate(uint32_t, uint32_t);
+void trace_report(void);
+void trace_stats_send(void);
+void trace_irq_start(void);
+void trace_irq_send(void);
+
+#endif      /* __trace_h__ */
@@ -32,8 +32,29 @@
 #define     UART_CMD_GET_PIX    10
 #define     UART_CMD_PALETTE    11
 #define     UART_CMD_CLR_SCR    12
+#define     UART_CMD_MEM_WRITE  13
+#define     UART_CMD_LINE       14
+#define     UART_CMD_RECT       15
+#define     UART_CMD_FILL_RECT  16
+#define     UART_CMD_SPAN       17
+#define     UART_CMD_COPY_RECT  18
+#define     UART_CMD_COPY_TEXT  19
+#define     UART_CMD_DAC_WRITE  20
+#define     UART_CMD_PIX_WRITE  21
+#define     UART_CMD_TELETYPE   22
+#define     UART_CMD_FONT_LOAD  23
+#define     UART_CMD_ANSI_OUT   64          // queue 1
+#define     UART_CMD_MONITOR    248         // queue 3
+#define     UART_CMD_IRQ_STATS  249         // queue 3
+#define     UART_CMD_PROFILE    250         // queue 3
+#define     UART_CMD_EVENTS     251         // queue 3
+#define     UART_CMD_LOG        252         // queue 3
+#define     UART_CMD_STATS      253         // queue 3
+#define     UART_CMD_TRACE      254         // queue 3
 #define     UART_CMD_ECHO       255
 
+#define     UART_DATA_MAX       768         // max data bytes trailing a command's parameter bytes (256 DAC colors)
+
 typedef struct
 {
     int cmd;
@@ -44,6 +65,8 @@ typedef struct
 {
     int         queue;
     cmd_param_t cmd_param;
+    int         data_count;
+    uint8_t     data[UART_DATA_MAX];
 } cmd_q_t;
 
 /********************************************************************
@@ -54,7 +77,10 @@ int      uart_init(void);
 cmd_q_t* uart_get_cmd(void);
 int      uart_recv_cmd(void);
 void     uart_send(uint8_t);
+void     uart_send_word(uint32_t);
 void     uart_rts_active(void);
 void     uart_rts_not_active(void);
+void     uart_replay(uint8_t*, int);
+int      uart_replay_active(void);
 
 #endif      /* __uart_h__ */
@@ -10,16 +10,38 @@
 #ifndef __util_h__
 #define __util_h__
 
+#include    <stdint.h>
+
+#include    "config.h"
+
 #define     DB_ERR      0
 #define     DB_INFO     1
 #define     DB_VERBOSE  2
 
+#define     LOG_MAGIC       0x4C414756  // "VGAL" little endian, log dump header
+#define     LOG_VERSION     1
+#define     LOG_MAX_ARGS    10
+
+/* Debug messages are recorded in a binary log ring, with a pointer to
+ * the format string and the raw 32-bit arguments, and formatted later.
+ * Arguments must be integers, characters, or pointers to constant strings.
+ * Messages of a type at or above UTIL_LOG_LEVEL are removed at compile time.
+ */
+#define     LOG_NARGS(...)      LOG_NARGS_(0, ##__VA_ARGS__, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define     LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, n, ...)     n
+
+#define     debug(type, format, ...) \
+                do { if ( (type) < UTIL_LOG_LEVEL ) \
+                         log_write((type), (format), LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__); } while ( 0 )
+
 /********************************************************************
  * Function prototypes
  *
  */
 void debug_lvl(int);
-int  debug(int, char *, ...);
+void log_write(int, const char *, int, ...);
+void log_idle(void);
+void log_send(void);
 void echo_reply(void);
 void halt(char *);
 void _putchar(char);
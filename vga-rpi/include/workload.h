@@ -0,0 +1,21 @@
+/********************************************************************
+ * workload.h
+ *
+ *  Built-in synthetic workload generator.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#ifndef __workload_h__
+#define __workload_h__
+
+/********************************************************************
+ * Function prototypes
+ *
+ */
+void workload_start(void);
+int  workload_active(void);
+void workload_idle(void);
+
+#endif      /* __workload_h__ */
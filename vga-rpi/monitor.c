@@ -0,0 +1,254 @@
+/********************************************************************
+ * monitor.c
+ *
+ *  Main loop load monitor and stall detector.
+ *
+ *  The main loop times a command dispatch, or the deferred work it does
+ *  when there are no commands, between monitor_begin() and monitor_end(),
+ *  and calls monitor_loop() at the end of every iteration. Dispatch times
+ *  are accounted as busy time, deferred work as idle work time, and the
+ *  rest of the loop, polling for commands, as idle time, per MONITOR_INTERVAL,
+ *  so the busy share of the last interval shows how close the emulator
+ *  is to saturation. The longest dispatch or deferred work is kept with
+ *  its command, and the ones of MONITOR_STALL uSec or longer are counted
+ *  as stalls, logged, and light the ACT LED for MONITOR_LED_TIME when
+ *  MONITOR_STALL_LED is 1.
+ *
+ *  Load monitor query reply format, all values are 32-bit little endian:
+ *      magic 'VGAM', version, interval uSec,
+ *      last interval busy uSec, idle work uSec, idle uSec, commands, iterations,
+ *      longest dispatch or idle work uSec, its command byte or 0xffffffff for idle work,
+ *      System Timer at its end, stall count, stall threshold uSec
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#include    <stdint.h>
+
+#include    "timer.h"
+#include    "gpio.h"
+
+#include    "config.h"
+#include    "util.h"
+#include    "uart.h"
+#include    "monitor.h"
+
+/********************************************************************
+ * Definitions
+ *
+ */
+typedef struct
+{
+    uint32_t    busy;               // uSec dispatching commands
+    uint32_t    work;               // uSec in deferred work when there are no commands
+    uint32_t    idle;               // uSec in the rest of the loop
+    uint32_t    commands;
+    uint32_t    iterations;
+} monitor_interval_t;
+
+/********************************************************************
+ * Static function prototypes
+ *
+ */
+static void monitor_clear(void);
+
+/********************************************************************
+ * Module globals (static)
+ *
+ */
+static uint32_t             loop_time;          // System Timer at the end of the last iteration
+static uint32_t             section_start;      // System Timer at monitor_begin()
+static uint32_t             section_total;      // uSec between monitor_begin() and monitor_end() in this iteration
+static uint32_t             interval_start;
+static monitor_interval_t   current;
+static monitor_interval_t   last;               // last complete interval
+
+static uint32_t             longest = 0;        // longest dispatch or idle work since the last query
+static int                  longest_cmd = MONITOR_NO_CMD;
+static uint32_t             longest_time = 0;
+static uint32_t             stalls = 0;
+
+static int                  led_on = 0;
+static uint32_t             led_time;
+
+/*------------------------------------------------
+ * monitor_init()
+ *
+ *  Start the load monitor, call before the main loop.
+ *  The ACT LED GPIO is set up by uart_init().
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void monitor_init(void)
+{
+    loop_time = bcm2835_st_read();
+    interval_start = loop_time;
+    section_total = 0;
+
+    current.busy = 0;
+    current.work = 0;
+    current.idle = 0;
+    current.commands = 0;
+    current.iterations = 0;
+    last = current;
+
+    monitor_clear();
+
+#if MONITOR_STALL_LED
+    bcm2835_gpio_set(RPIB_ACT_LED);         // LED off
+#endif
+}
+
+/*------------------------------------------------
+ * monitor_begin()
+ *
+ *  Start timing a command dispatch or the deferred work
+ *  of an iteration without a command.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void monitor_begin(void)
+{
+    section_start = bcm2835_st_read();
+}
+
+/*------------------------------------------------
+ * monitor_end()
+ *
+ *  Account for a command dispatch or deferred work started with monitor_begin(),
+ *  keep it if it is the longest, and count it as a stall if it is too long.
+ *
+ * param:  command byte dispatched, MONITOR_NO_CMD for deferred work
+ * return: none
+ *
+ */
+void monitor_end(int cmd)
+{
+    uint32_t    now, time;
+
+    now = bcm2835_st_read();
+    time = now - section_start;
+    section_total += time;
+
+    if ( cmd == MONITOR_NO_CMD )
+    {
+        current.work += time;
+    }
+    else
+    {
+        current.busy += time;
+        current.commands++;
+    }
+
+    if ( time > longest )
+    {
+        longest = time;
+        longest_cmd = cmd;
+        longest_time = now;
+    }
+
+    if ( time >= MONITOR_STALL )
+    {
+        stalls++;
+        debug(DB_INFO, "stall %u uSec, command %d\n", time, cmd);
+
+#if MONITOR_STALL_LED
+        bcm2835_gpio_clr(RPIB_ACT_LED);     // LED is active low
+        led_on = 1;
+        led_time = now;
+#endif
+    }
+}
+
+/*------------------------------------------------
+ * monitor_loop()
+ *
+ *  Account for the rest of a main loop iteration as idle time,
+ *  call at the end of every iteration.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void monitor_loop(void)
+{
+    uint32_t    now, time;
+
+    now = bcm2835_st_read();
+    time = now - loop_time;
+    loop_time = now;
+
+    current.iterations++;
+    if ( time > section_total )
+        current.idle += time - section_total;
+    section_total = 0;
+
+    if ( led_on && (now - led_time) >= MONITOR_LED_TIME )
+    {
+        bcm2835_gpio_set(RPIB_ACT_LED);
+        led_on = 0;
+    }
+
+    if ( (now - interval_start) >= MONITOR_INTERVAL )
+    {
+        last = current;
+        current.busy = 0;
+        current.work = 0;
+        current.idle = 0;
+        current.commands = 0;
+        current.iterations = 0;
+        interval_start = now;
+    }
+}
+
+/*------------------------------------------------
+ * monitor_send()
+ *
+ *  Send the load of the last complete interval, the longest dispatch
+ *  or idle work and the stall count in binary, and clear the longest
+ *  and the stall count.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void monitor_send(void)
+{
+    uart_send_word(MONITOR_MAGIC);
+    uart_send_word(MONITOR_VERSION);
+    uart_send_word(MONITOR_INTERVAL);
+    uart_send_word(last.busy);
+    uart_send_word(last.work);
+    uart_send_word(last.idle);
+    uart_send_word(last.commands);
+    uart_send_word(last.iterations);
+    uart_send_word(longest);
+    uart_send_word((uint32_t)longest_cmd);
+    uart_send_word(longest_time);
+    uart_send_word(stalls);
+    uart_send_word(MONITOR_STALL);
+
+    monitor_clear();
+}
+
+/*------------------------------------------------
+ * monitor_clear()
+ *
+ *  Clear the longest dispatch or idle work and the stall count.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void monitor_clear(void)
+{
+    longest = 0;
+    longest_cmd = MONITOR_NO_CMD;
+    longest_time = 0;
+    stalls = 0;
+}
@@ -0,0 +1,215 @@
+/********************************************************************
+ * profile.c
+ *
+ *  Sampling profiler of the interrupted PC on a System Timer interrupt.
+ *
+ *  While the profiler runs, System Timer compare 3 interrupts every
+ *  PROFILE_INTERVAL uSec and the interrupt handler counts the PC it
+ *  interrupted, taken from the registers irq_handler saved on the
+ *  IRQ stack, in a histogram of the program's code address range.
+ *  Code that runs with interrupts disabled, including the other
+ *  interrupt handlers, is counted at the instruction that enables
+ *  interrupts again. The histogram is sent on request and symbolized
+ *  against the ELF file with tools/vgaprof.py.
+ *
+ *  Profile dump format, all values are 32-bit little endian:
+ *      magic 'VGAP', version, sampling interval uSec, bucket size in bytes,
+ *      sample count, samples outside of the code range, record count N,
+ *      N x {bucket start address, sample count}, only buckets with samples
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#include    <stdint.h>
+
+#include    "timer.h"
+#include    "irq.h"
+
+#include    "config.h"
+#include    "util.h"
+#include    "uart.h"
+#include    "profile.h"
+
+/********************************************************************
+ * Definitions
+ *
+ */
+#define     PROFILE_BUCKETS     16384       // histogram buckets over the code range
+#define     PROFILE_MIN_SHIFT   2           // smallest bucket is one instruction
+
+#define     PROFILE_ACTION      (cmd_param->b1)
+
+/********************************************************************
+ * Static function prototypes
+ *
+ */
+static void profile_isr(void);
+static void profile_clear(void);
+
+/********************************************************************
+ * Module globals (static)
+ *
+ */
+extern char             _start[];           // code range from the linker
+extern char             _etext[];
+
+static uint32_t         histogram[PROFILE_BUCKETS];
+static uint32_t         text_start;
+static uint32_t         text_end;
+static int              bucket_shift;       // log2 of the bucket size in bytes
+static volatile uint32_t samples = 0;
+static volatile uint32_t outside = 0;       // samples outside of the code range
+static int              profile_on = 0;
+
+/*------------------------------------------------
+ * profile_init()
+ *
+ *  Size the histogram buckets to the code range and register the
+ *  profiler's System Timer interrupt handler. Call after uart_init(),
+ *  the UART interrupt keeps the higher priority.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void profile_init(void)
+{
+    text_start = (uint32_t)(uintptr_t)_start;
+    text_end = (uint32_t)(uintptr_t)_etext;
+
+    bucket_shift = PROFILE_MIN_SHIFT;
+    while ( ((text_end - text_start) >> bucket_shift) >= PROFILE_BUCKETS )
+        bucket_shift++;
+
+    profile_clear();
+
+    if ( !irq_register_handler(IRQ_SYSTEM_TIMER3, profile_isr) )
+        debug(DB_ERR, "%s: interrupt handler registration failed\n", __FUNCTION__);
+}
+
+/*------------------------------------------------
+ * profile_control()
+ *
+ *  System queue profile command.
+ *
+ * param:  command parameters, b1 is the action
+ * return: none
+ *
+ */
+void profile_control(cmd_param_t *cmd_param)
+{
+    int         i;
+    uint32_t    records;
+
+    switch ( PROFILE_ACTION )
+    {
+        case PROFILE_STOP:
+            irq_disable(IRQ_SYSTEM_TIMER3);
+            profile_on = 0;
+            break;
+
+        case PROFILE_START:
+            profile_clear();
+            if ( !profile_on )
+            {
+                bcm2835_st_clr_compare_match(ST_COMPARE3);
+                bcm2835_st_set_compare(ST_COMPARE3, PROFILE_INTERVAL);
+                irq_enable(IRQ_SYSTEM_TIMER3);
+                profile_on = 1;
+            }
+            break;
+
+        case PROFILE_DUMP:
+            // sampling pauses while the dump is sent, so the record count
+            // holds and the dump does not profile itself
+            if ( profile_on )
+                irq_disable(IRQ_SYSTEM_TIMER3);
+
+            records = 0;
+            for ( i = 0; i < PROFILE_BUCKETS; i++ )
+            {
+                if ( histogram[i] )
+                    records++;
+            }
+
+            uart_send_word(PROFILE_MAGIC);
+            uart_send_word(PROFILE_VERSION);
+            uart_send_word(PROFILE_INTERVAL);
+            uart_send_word(1 << bucket_shift);
+            uart_send_word(samples);
+            uart_send_word(outside);
+            uart_send_word(records);
+
+            for ( i = 0; i < PROFILE_BUCKETS; i++ )
+            {
+                if ( histogram[i] == 0 )
+                    continue;
+
+                uart_send_word(text_start + (i << bucket_shift));
+                uart_send_word(histogram[i]);
+            }
+
+            if ( profile_on )
+            {
+                bcm2835_st_clr_compare_match(ST_COMPARE3);
+                bcm2835_st_set_compare(ST_COMPARE3, PROFILE_INTERVAL);
+                irq_enable(IRQ_SYSTEM_TIMER3);
+            }
+            break;
+
+        default:
+            debug(DB_ERR, "%s: invalid profile action %d\n", __FUNCTION__, PROFILE_ACTION);
+    }
+}
+
+/*------------------------------------------------
+ * profile_isr()
+ *
+ *  System Timer compare 3 interrupt handler, counts the interrupted PC
+ *  and sets up the next sample.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void profile_isr(void)
+{
+    uint32_t    pc;
+
+    bcm2835_st_clr_compare_match(ST_COMPARE3);
+    bcm2835_st_set_compare(ST_COMPARE3, PROFILE_INTERVAL);
+
+    pc = irq_interrupted_pc();
+
+    if ( pc >= text_start && pc < text_end )
+        histogram[(pc - text_start) >> bucket_shift]++;
+    else
+        outside++;
+
+    samples++;
+}
+
+/*------------------------------------------------
+ * profile_clear()
+ *
+ *  Clear the histogram and sample counts.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void profile_clear(void)
+{
+    int         i;
+
+    disable();
+
+        for ( i = 0; i < PROFILE_BUCKETS; i++ )
+            histogram[i] = 0;
+
+        samples = 0;
+        outside = 0;
+
+    enable();
+}
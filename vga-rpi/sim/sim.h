@@ -0,0 +1,39 @@
+/********************************************************************
+ * sim.h
+ *
+ *  Host simulation of the VGA emulator.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#ifndef __sim_h__
+#define __sim_h__
+
+#include    <stdint.h>
+
+#define     SIM_RX_IDLE_END     64          // empty receive polls after the end of the stream before stopping
+
+typedef struct
+{
+    uint32_t    clock_step;                 // System Timer advance per read in uSec
+    long        rx_bytes;
+    long        tx_bytes;
+    long        mailbox_calls;
+} sim_stats_t;
+
+extern sim_stats_t sim_stats;
+
+/********************************************************************
+ * Function prototypes
+ *
+ */
+void     sim_init(uint8_t*, long, uint32_t);
+uint32_t sim_frame_hash(void);
+int      sim_frame_dump(const char*);
+void     sim_frame_size(uint32_t*, uint32_t*);
+void     sim_end(void);
+
+void     kernel(uint32_t, uint32_t, uint32_t);
+
+#endif      /* __sim_h__ */
@@ -0,0 +1,507 @@
+/********************************************************************
+ * sim_hw.c
+ *
+ *  Host stand-ins for the BCM2835 library functions used by the
+ *  VGA emulator, for running the emulator as a Linux program.
+ *  - Mailbox property interface with a memory frame buffer
+ *  - Auxiliary UART receive from a byte stream, transmit to stdout
+ *  - System Timer that advances a fixed step on every read,
+ *    or follows the host's clock with a step of 0
+ *  - GPIO, interrupt controller and timer compare functions that do nothing
+ *  - Performance monitor that counts nothing
+ *
+ *  The emulator stores frame buffer and palette addresses in 32-bit
+ *  mailbox values, so the program must be linked without PIE and the
+ *  frame buffer is mapped in the low 4GB of the address space.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#define     _GNU_SOURCE
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <stdint.h>
+#include    <stdarg.h>
+#include    <string.h>
+#include    <sys/mman.h>
+#include    <time.h>
+
+#include    "bcm2835.h"
+#include    "auxuart.h"
+#include    "gpio.h"
+#include    "irq.h"
+#include    "timer.h"
+#include    "mailbox.h"
+#include    "pmu.h"
+
+#include    "sim.h"
+
+/********************************************************************
+ * Definitions
+ *
+ */
+#define     SIM_FB_MEM          (16*1024*1024)  // frame buffer memory
+#define     SIM_TAG_WORDS       7               // tag, value length, status, four values
+#define     SIM_TAG_MAX         32              // tags in one mailbox transaction
+#define     SIM_DISPLAY_X       1920            // display resolution before the first mode set
+#define     SIM_DISPLAY_Y       1080
+
+/********************************************************************
+ * Module globals
+ *
+ */
+static uint8_t     *fb_mem = 0;
+static uint32_t     phys_x = 0, phys_y = 0;
+static uint32_t     virt_x = 0, virt_y = 0;
+static uint32_t     offset_x = 0, offset_y = 0;
+static uint32_t     palette[256];
+
+static uint32_t     property_tags[SIM_TAG_WORDS * (SIM_TAG_MAX + 1)];
+static int          property_index = 0;
+
+static uint8_t     *rx_stream = 0;
+static long         rx_length = 0;
+static long         rx_position = 0;
+static int          rx_idle = 0;
+
+static uint32_t     clock_us = 0;
+
+sim_stats_t         sim_stats;
+
+/*------------------------------------------------
+ * sim_init()
+ *
+ *  Initialize the simulation with a receive byte stream.
+ *
+ *  param:  receive stream, stream length in bytes, clock step per timer read in uSec
+ *  return: none
+ */
+void sim_init(uint8_t *stream, long length, uint32_t clock_step)
+{
+    rx_stream = stream;
+    rx_length = length;
+    rx_position = 0;
+    rx_idle = 0;
+
+    memset(&sim_stats, 0, sizeof(sim_stats_t));
+    sim_stats.clock_step = clock_step;
+}
+
+/*------------------------------------------------
+ * sim_frame_hash()
+ *
+ *  FNV-1a hash of the displayed frame's RGB pixels.
+ *
+ *  param:  none
+ *  return: hash
+ */
+uint32_t sim_frame_hash(void)
+{
+    uint32_t    x, y, color, hash;
+    uint8_t    *line;
+
+    hash = 2166136261U;
+
+    if ( fb_mem == 0 )
+        return hash;
+
+    for ( y = 0; y < phys_y; y++ )
+    {
+        line = fb_mem + (y + offset_y) * virt_x + offset_x;
+        for ( x = 0; x < phys_x; x++ )
+        {
+            color = palette[line[x]] & 0x00ffffff;
+            hash = (hash ^ (color & 0xff)) * 16777619U;
+            hash = (hash ^ ((color >> 8) & 0xff)) * 16777619U;
+            hash = (hash ^ (color >> 16)) * 16777619U;
+        }
+    }
+
+    return hash;
+}
+
+/*------------------------------------------------
+ * sim_frame_dump()
+ *
+ *  Write the displayed frame to a binary PPM file.
+ *
+ *  param:  file name
+ *  return: 0 if no error, -1 if error
+ */
+int sim_frame_dump(const char *file_name)
+{
+    FILE       *ppm;
+    uint32_t    x, y, color;
+    uint8_t     rgb[3];
+    uint8_t    *line;
+
+    if ( fb_mem == 0 )
+        return -1;
+
+    ppm = fopen(file_name, "wb");
+    if ( ppm == NULL )
+        return -1;
+
+    fprintf(ppm, "P6\n%u %u\n255\n", phys_x, phys_y);
+
+    for ( y = 0; y < phys_y; y++ )
+    {
+        line = fb_mem + (y + offset_y) * virt_x + offset_x;
+        for ( x = 0; x < phys_x; x++ )
+        {
+            // palette is BGR
+            color = palette[line[x]];
+            rgb[0] = color & 0xff;
+            rgb[1] = (color >> 8) & 0xff;
+            rgb[2] = (color >> 16) & 0xff;
+            fwrite(rgb, 1, sizeof(rgb), ppm);
+        }
+    }
+
+    fclose(ppm);
+
+    return 0;
+}
+
+/*------------------------------------------------
+ * sim_frame_size()
+ *
+ *  Displayed frame resolution.
+ *
+ *  param:  pointers to width and height
+ *  return: none
+ */
+void sim_frame_size(uint32_t *width, uint32_t *height)
+{
+    *width = phys_x;
+    *height = phys_y;
+}
+
+/********************************************************************
+ * Auxiliary UART
+ *
+ */
+int bcm2835_auxuart_init(baud_t baud_rate, uint32_t rx_tout, uint32_t tx_tout, uint32_t configuration)
+{
+    return 1;
+}
+
+/*------------------------------------------------
+ * bcm2835_auxuart_rx_byte()
+ *
+ *  Return the next byte of the receive stream. The emulator is
+ *  stopped through sim_end() after the stream ends and the main
+ *  loop had time to process the queued commands.
+ *
+ */
+int bcm2835_auxuart_rx_byte(uint8_t *byte)
+{
+    if ( rx_position < rx_length )
+    {
+        *byte = rx_stream[rx_position++];
+        sim_stats.rx_bytes++;
+        return 1;
+    }
+
+    if ( ++rx_idle > SIM_RX_IDLE_END )
+        sim_end();
+
+    return 0;
+}
+
+void bcm2835_auxuart_putchr(uint8_t byte)
+{
+    sim_stats.tx_bytes++;
+    fputc(byte, stdout);
+}
+
+/********************************************************************
+ * System Timer
+ *
+ */
+uint32_t bcm2835_st_read(void)
+{
+    struct timespec now;
+
+    if ( sim_stats.clock_step == 0 )
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint32_t)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+    }
+
+    clock_us += sim_stats.clock_step;
+    return clock_us;
+}
+
+/********************************************************************
+ * System Timer compare, without interrupts
+ *
+ */
+int bcm2835_st_set_compare(comp_reg_t compare_reg, uint32_t interval)
+{
+    return 1;
+}
+
+void bcm2835_st_clr_compare_match(comp_reg_t compare_reg)
+{
+}
+
+/********************************************************************
+ * GPIO and interrupts
+ *
+ */
+int bcm2835_gpio_fsel(RPiGPIOPin_t pin, bcm2835FunctionSelect_t mode)
+{
+    return 1;
+}
+
+void bcm2835_gpio_set(int pin)
+{
+}
+
+void bcm2835_gpio_clr(int pin)
+{
+}
+
+void irq_init(void)
+{
+}
+
+void irq_global_enable(void)
+{
+}
+
+void irq_global_disable(void)
+{
+}
+
+uint32_t irq_global_save(void)
+{
+    return 0;
+}
+
+void irq_global_restore(uint32_t state)
+{
+}
+
+void irq_section_enter(void)
+{
+}
+
+void irq_section_exit(void)
+{
+}
+
+void irq_stats_start(uint32_t (*clock_func)(void))
+{
+}
+
+int irq_stats_get(int handler, irq_stats_t *stats)
+{
+    return 0;
+}
+
+void irq_stats_masked(uint32_t *max_ticks, uint32_t *max_pc)
+{
+    *max_ticks = 0;
+    *max_pc = 0;
+}
+
+void irq_register_monitor(void (*monitor_func)(intr_source_t source, int done))
+{
+}
+
+int irq_register_handler(intr_source_t source, void (*handler_func)(void))
+{
+    return 1;
+}
+
+void irq_enable(intr_source_t source)
+{
+}
+
+void irq_disable(intr_source_t source)
+{
+}
+
+uint32_t irq_interrupted_pc(void)
+{
+    return 0;
+}
+
+/********************************************************************
+ * Performance monitor
+ *
+ */
+void pmu_init(pmu_event_t event0, pmu_event_t event1)
+{
+}
+
+void pmu_start(void)
+{
+}
+
+void pmu_poll(void)
+{
+}
+
+uint32_t pmu_read(pmu_counter_t counter)
+{
+    return 0;
+}
+
+void pmu_sample(pmu_sample_t *sample)
+{
+    memset(sample, 0, sizeof(pmu_sample_t));
+}
+
+void pmu_sample_delta(pmu_sample_t *sample)
+{
+    memset(sample, 0, sizeof(pmu_sample_t));
+}
+
+/********************************************************************
+ * Mailbox property interface
+ *
+ *  Every tag takes SIM_TAG_WORDS words in the property buffer,
+ *  which is only read through bcm2835_mailbox_get_property().
+ *
+ */
+void bcm2835_mailbox_init(void)
+{
+    memset(property_tags, 0, sizeof(property_tags));
+    property_index = 0;
+}
+
+void bcm2835_mailbox_add_tag(uint32_t tag, ...)
+{
+    va_list     args;
+    uint32_t   *values;
+    uint32_t   *colors;
+    uint32_t    offset, length, i;
+
+    if ( property_index >= (SIM_TAG_WORDS * SIM_TAG_MAX) )
+    {
+        fprintf(stderr, "%s: too many tags\n", __FUNCTION__);
+        exit(1);
+    }
+
+    property_tags[property_index] = tag;
+    property_tags[property_index + 1] = 16;
+    values = &property_tags[property_index + 3];
+
+    va_start(args, tag);
+
+    switch ( tag )
+    {
+        case TAG_FB_ALLOCATE:
+        case TAG_FB_SET_DEPTH:
+            values[0] = va_arg(args, uint32_t);
+            break;
+
+        case TAG_FB_SET_PHYS_DISPLAY:
+        case TAG_FB_SET_VIRT_DISPLAY:
+        case TAG_FB_SET_VIRT_OFFSET:
+            values[0] = va_arg(args, uint32_t);
+            values[1] = va_arg(args, uint32_t);
+            break;
+
+        case TAG_FB_SET_OVERSCAN:
+            for ( i = 0; i < 4; i++ )
+                values[i] = va_arg(args, uint32_t);
+            break;
+
+        case TAG_FB_SET_PALETTE:
+            offset = va_arg(args, uint32_t);
+            length = va_arg(args, uint32_t);
+            colors = (uint32_t*)(uintptr_t)va_arg(args, uint32_t);
+            for ( i = 0; i < length && (offset + i) < 256; i++ )
+                palette[offset + i] = colors[i];
+            break;
+
+        default:;
+    }
+
+    va_end(args);
+
+    property_index += SIM_TAG_WORDS;
+}
+
+uint32_t *bcm2835_mailbox_process(void)
+{
+    int         i;
+    uint32_t   *values;
+
+    sim_stats.mailbox_calls++;
+
+    if ( fb_mem == 0 )
+    {
+        fb_mem = mmap(NULL, SIM_FB_MEM, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+        if ( fb_mem == MAP_FAILED )
+        {
+            fprintf(stderr, "%s: frame buffer mmap() failed\n", __FUNCTION__);
+            exit(1);
+        }
+    }
+
+    for ( i = 0; i < property_index; i += SIM_TAG_WORDS )
+    {
+        values = &property_tags[i + 3];
+
+        switch ( property_tags[i] )
+        {
+            case TAG_FB_GET_PHYS_DISPLAY:
+                values[0] = phys_x ? phys_x : SIM_DISPLAY_X;
+                values[1] = phys_y ? phys_y : SIM_DISPLAY_Y;
+                break;
+
+            case TAG_FB_SET_PHYS_DISPLAY:
+                phys_x = values[0];
+                phys_y = values[1];
+                break;
+
+            case TAG_FB_SET_VIRT_DISPLAY:
+                virt_x = values[0];
+                virt_y = values[1];
+                break;
+
+            case TAG_FB_SET_VIRT_OFFSET:
+                offset_x = values[0];
+                offset_y = values[1];
+                break;
+
+            case TAG_FB_ALLOCATE:
+                if ( (virt_x * virt_y) > SIM_FB_MEM )
+                {
+                    fprintf(stderr, "%s: frame buffer too large\n", __FUNCTION__);
+                    exit(1);
+                }
+                values[0] = (uint32_t)(uintptr_t)fb_mem;
+                values[1] = virt_x * virt_y;
+                break;
+
+            case TAG_FB_GET_PITCH:
+                values[0] = virt_x;
+                break;
+
+            default:;
+        }
+    }
+
+    return property_tags;
+}
+
+mailbox_tag_property_t *bcm2835_mailbox_get_property(uint32_t tag)
+{
+    int         i;
+
+    for ( i = 0; i < property_index; i += SIM_TAG_WORDS )
+    {
+        if ( property_tags[i] == tag )
+            return (mailbox_tag_property_t*)&property_tags[i];
+    }
+
+    return NULL;
+}
@@ -0,0 +1,171 @@
+/********************************************************************
+ * sim_main.c
+ *
+ *  Host simulation of the VGA emulator.
+ *  Runs the emulator's main loop with a file as the UART receive
+ *  stream, and reports the final frame's hash when the stream ends.
+ *  UART transmit bytes (command replies) are written to stdout.
+ *  With '-r' the file is replayed through the emulator's trace replay,
+ *  the file can be a trace dump or a plain stream, and the replay's
+ *  command statistics are written to stdout.
+ *  A clock step of 0 runs the System Timer on the host's clock.
+ *
+ *  usage: vga-sim [-r] [-c clock_step] [-o frame.ppm] stream.bin
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <stdint.h>
+#include    <unistd.h>
+#include    <time.h>
+
+#include    "uart.h"
+#include    "trace.h"
+#include    "sim.h"
+
+#define     SIM_USAGE           "usage: %s [-r] [-c clock_step] [-o frame.ppm] stream.bin\n"
+#define     SIM_TRACE_HEADER    16          // trace dump header bytes
+
+/********************************************************************
+ * Module globals
+ *
+ */
+static const char  *frame_file = NULL;
+static struct timespec start_time;
+
+/*------------------------------------------------
+ * main()
+ *
+ */
+int main(int argc, char *argv[])
+{
+    FILE       *stream_file;
+    uint8_t    *stream;
+    long        length;
+    uint32_t    clock_step = 1;
+    uint32_t    stream_bytes;
+    int         opt, replay = 0;
+
+    while ( (opt = getopt(argc, argv, "rc:o:")) != -1 )
+    {
+        switch ( opt )
+        {
+            case 'r':
+                replay = 1;
+                break;
+
+            case 'c':
+                clock_step = (uint32_t)atoi(optarg);
+                break;
+
+            case 'o':
+                frame_file = optarg;
+                break;
+
+            default:
+                fprintf(stderr, SIM_USAGE, argv[0]);
+                return 1;
+        }
+    }
+
+    if ( optind >= argc )
+    {
+        fprintf(stderr, SIM_USAGE, argv[0]);
+        return 1;
+    }
+
+    /* Read the receive stream
+     */
+    stream_file = fopen(argv[optind], "rb");
+    if ( stream_file == NULL )
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    fseek(stream_file, 0, SEEK_END);
+    length = ftell(stream_file);
+    fseek(stream_file, 0, SEEK_SET);
+
+    stream = malloc(length + 1);
+    if ( stream == NULL || fread(stream, 1, length, stream_file) != (size_t)length )
+    {
+        fprintf(stderr, "%s: error reading stream\n", argv[optind]);
+        return 1;
+    }
+
+    fclose(stream_file);
+
+    /* Run the emulator, it only returns if initialization failed
+     * or on a test abort command
+     */
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    if ( replay )
+    {
+        // skip a trace dump header, the time stamps are not used
+        if ( length >= SIM_TRACE_HEADER &&
+             (stream[0] | (stream[1] << 8) | (stream[2] << 16) | ((uint32_t)stream[3] << 24)) == TRACE_MAGIC )
+        {
+            stream_bytes = stream[8] | (stream[9] << 8) | (stream[10] << 16) | ((uint32_t)stream[11] << 24);
+            if ( stream_bytes > (length - SIM_TRACE_HEADER) )
+            {
+                fprintf(stderr, "%s: truncated trace\n", argv[optind]);
+                return 1;
+            }
+            uart_replay(stream + SIM_TRACE_HEADER, stream_bytes);
+        }
+        else
+        {
+            uart_replay(stream, length);
+        }
+
+        sim_init(NULL, 0, clock_step);
+    }
+    else
+    {
+        sim_init(stream, length, clock_step);
+    }
+
+    kernel(0, 0, 0);
+
+    sim_end();
+
+    return 0;
+}
+
+/*------------------------------------------------
+ * sim_end()
+ *
+ *  Report the run's results, save the final frame, and exit.
+ *
+ *  param:  none
+ *  return: does not return
+ */
+void sim_end(void)
+{
+    struct timespec end_time;
+    uint32_t    width, height;
+    double      elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    elapsed = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+
+    fflush(stdout);
+
+    sim_frame_size(&width, &height);
+    fprintf(stderr, "frame %ux%u hash %08x mbox %ld rx %ld tx %ld time %.6f sec\n",
+                    width, height, sim_frame_hash(), sim_stats.mailbox_calls,
+                    sim_stats.rx_bytes, sim_stats.tx_bytes, elapsed);
+
+    if ( frame_file && sim_frame_dump(frame_file) == -1 )
+    {
+        fprintf(stderr, "%s: error writing frame\n", frame_file);
+        exit(1);
+    }
+
+    exit(0);
+}
@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+###############################################################################
+#
+# simtest.py
+#
+#   Command stream checks run with the host simulation.
+#   Every check builds a SLIP framed command stream, runs it through vga-sim
+#   and checks the replies on stdout. Run with 'make simtest'.
+#
+#   usage: simtest.py [vga-sim]
+#
+#   October 18, 2026
+#
+###############################################################################
+
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+SIM = './vga-sim'
+SIM_TIMEOUT = 30                # seconds
+
+SLIP_END = 0xc0
+SLIP_ESC = 0xdb
+SLIP_ESC_END = 0xdc
+SLIP_ESC_ESC = 0xdd
+
+CMD_VID_MODE = 0
+CMD_CUR_POS = 2
+CMD_CUR_MODE = 3
+CMD_PUT_CHRA = 4
+CMD_PUT_CHR = 6
+CMD_COPY_TEXT = 19
+CMD_DAC_WRITE = 20
+CMD_ANSI_OUT = 64
+CMD_LOG = 252
+CMD_TRACE = 254
+CMD_ECHO = 255
+
+UART_DATA_MAX = 768
+ECHO_REPLY = bytes([6, 5, 4, 3, 2, 1])
+
+TRACE_START = 1
+TRACE_DUMP = 2
+TRACE_REPLAY = 3
+
+TRACE_MAGIC = 0x54414756
+LOG_MAGIC = 0x4C414756
+DB_ERR = 0
+
+CURSOR_HIDE = (0x20, 0x00)
+TEXT_COLUMNS = 80
+TEXT_ROWS = 25
+TRACE_RING_BYTES = 65536
+
+
+def packet(cmd, *params, data=b''):
+    """SLIP framed command packet, parameters are padded to six bytes."""
+    body = bytes([cmd] + list(params) + [0] * (6 - len(params))) + bytes(data)
+    frame = bytearray([SLIP_END])
+    for byte in body:
+        if byte == SLIP_END:
+            frame += bytes([SLIP_ESC, SLIP_ESC_END])
+        elif byte == SLIP_ESC:
+            frame += bytes([SLIP_ESC, SLIP_ESC_ESC])
+        else:
+            frame.append(byte)
+    frame.append(SLIP_END)
+    return bytes(frame)
+
+
+def run(stream, clock_step=1):
+    """Run a stream through the simulation, return its stdout bytes and the frame hash."""
+    # the simulation seeks in the stream file, so it can not be a pipe
+    with tempfile.NamedTemporaryFile(suffix='.bin', delete=False) as stream_file:
+        stream_file.write(stream)
+    try:
+        result = subprocess.run([SIM, '-c', str(clock_step), stream_file.name], stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE, timeout=SIM_TIMEOUT)
+    finally:
+        os.remove(stream_file.name)
+    if result.returncode != 0:
+        raise AssertionError('vga-sim exit code %d' % result.returncode)
+    return result.stdout, result.stderr.split()[3]
+
+
+def wrapped_capture():
+    """Stream that starts a capture and sends more than a ring of characters."""
+    stream = packet(CMD_TRACE, TRACE_START)
+    for i in range(10000):
+        stream += packet(CMD_PUT_CHR, ord('A') + i % 26, 0, 1)
+    return stream
+
+
+def test_trace_wrap_replay():
+    """A replay after the capture ring wrapped runs once and ends."""
+    reply, frame_hash = run(wrapped_capture() + packet(CMD_TRACE, TRACE_REPLAY))
+    reports = [line for line in reply.decode('latin-1').splitlines() if line.startswith('trace:')]
+    if len(reports) != 1:
+        raise AssertionError('%d replay reports' % len(reports))
+    if 'queue 3' in reply.decode('latin-1'):
+        raise AssertionError('trace command replayed')
+
+
+def test_trace_wrap_dump():
+    """A dump after the capture ring wrapped holds whole put-character packets only."""
+    reply, frame_hash = run(wrapped_capture() + packet(CMD_TRACE, TRACE_DUMP))
+    magic, version, length, stamps = struct.unpack_from('<IIII', reply, 0)
+    if magic != TRACE_MAGIC or length == 0 or length > TRACE_RING_BYTES:
+        raise AssertionError('bad dump header, length %d' % length)
+    stream = reply[16:16 + length]
+    if stream[0] != SLIP_END or stream[-1] != SLIP_END:
+        raise AssertionError('dump does not start and end on a packet delimiter')
+    frames = [frame for frame in stream.split(bytes([SLIP_END])) if frame]
+    for frame in frames:
+        if len(frame) != 7 or frame[0] != CMD_PUT_CHR:
+            raise AssertionError('unexpected packet %s in dump' % frame.hex())
+
+
+def log_types(reply):
+    """Message types of the log reply in a command reply stream."""
+    start = reply.find(struct.pack('<I', LOG_MAGIC))
+    if start < 0:
+        raise AssertionError('no log reply')
+    magic, version, words, dropped = struct.unpack_from('<IIII', reply, start)
+    if words < 3:
+        raise AssertionError('log reply with %d words' % words)
+    types = []
+    position = 0
+    while position < words:
+        header, = struct.unpack_from('<I', reply, start + 16 + position * 4)
+        types.append(header & 0xff)
+        position += 3 + ((header >> 8) & 0xff)
+    return types
+
+
+def test_log_error():
+    """An unsupported mode set records an error message in the log."""
+    reply, frame_hash = run(packet(CMD_VID_MODE, 100) + packet(CMD_LOG))
+    types = log_types(reply)
+    if DB_ERR not in types:
+        raise AssertionError('no error message, message types %s' % types)
+
+
+def test_packet_too_long():
+    """A packet that is too long, ending in an escaped byte, is discarded and later packets work."""
+    data = bytes([0x3f]) * UART_DATA_MAX + bytes([SLIP_END]) * 4
+    reply, frame_hash = run(packet(CMD_DAC_WRITE, 0, data=data) + packet(CMD_ECHO, 1, 2, 3, 4, 5, 6) + packet(CMD_LOG))
+    if ECHO_REPLY not in reply:
+        raise AssertionError('no echo reply after the long packet')
+    types = log_types(reply)
+    if DB_ERR not in types:
+        raise AssertionError('long packet not reported, message types %s' % types)
+
+
+def cursor_stream(shapes, delay, copy=False):
+    """Text stream that sets cursor shapes, with 'delay' characters written away from the cursor after each.
+    With 'copy' the cell under the cursor is copied to column 10 row 10 before the last shape."""
+    stream = packet(CMD_VID_MODE, 3) + packet(CMD_PUT_CHRA, 0, ord('A'), 0, 0, 0, 0x07) + packet(CMD_CUR_POS, 0, 0, 0, 0)
+    for i, (top, bottom) in enumerate(shapes):
+        if copy and i == len(shapes) - 1:
+            stream += packet(CMD_COPY_TEXT, 0, 0, 0, 0, 0, 0, data=bytes([10, 10]))
+        stream += packet(CMD_CUR_MODE, top, bottom)
+        for j in range(delay):
+            stream += packet(CMD_PUT_CHRA, 0, ord('B'), 40, 5, 0, 0x07)
+    return stream
+
+
+def test_cursor_erase():
+    """Hiding the cursor, after a shape change, leaves no inverted rows at any blink phase."""
+    for shapes in ([(6, 7), CURSOR_HIDE], [(0, 7), (6, 7), CURSOR_HIDE]):
+        for delay in range(0, 40):
+            reply, frame_hash = run(cursor_stream(shapes, delay), 1000)
+            reply, hidden_hash = run(cursor_stream([CURSOR_HIDE] * len(shapes), delay), 1000)
+            if frame_hash != hidden_hash:
+                raise AssertionError('cursor left on the screen, shapes %s, %d characters' % (shapes, delay))
+
+
+def test_cursor_copy_text():
+    """A text window copy does not copy the cursor at any blink phase."""
+    shapes = [(6, 7), CURSOR_HIDE]
+    for delay in range(0, 40):
+        reply, frame_hash = run(cursor_stream(shapes, delay, copy=True), 1000)
+        reply, hidden_hash = run(cursor_stream([CURSOR_HIDE] * len(shapes), delay, copy=True), 1000)
+        if frame_hash != hidden_hash:
+            raise AssertionError('cursor copied, %d characters' % delay)
+
+
+def text_cells(column, row, text, attribute):
+    """Put character commands that write a text run."""
+    stream = b''
+    for i, character in enumerate(text):
+        stream += packet(CMD_PUT_CHRA, 0, ord(character), column + i, row, 0, attribute)
+    return stream
+
+
+def test_ansi_terminal():
+    """Cursor position, erase and graphic rendition sequences draw the same frame as put character commands.
+    A full width line, and the bottom right cell, do not wrap until the next printable character."""
+    start = packet(CMD_VID_MODE, 3) + packet(CMD_CUR_MODE, *CURSOR_HIDE)
+    terminal = (b'\x1b[2J\x1b[H'
+                b'\x1b[5;11H\x1b[1;31;44mHe\x7fllo\x1b[K\x1b[0m'
+                b'\x1b[10;1H' + b'A' * TEXT_COLUMNS + b'\r\nnext'
+                b'\x1b[20;40H\x1b[42m\x1b[J\x1b[m'
+                b'\x1b[25;80HX')
+    reply, frame_hash = run(start + packet(CMD_ANSI_OUT, data=terminal))
+
+    # bright red on blue, the erased cells take the blue background
+    expected = start + text_cells(10, 4, 'Hello', 0x1c) + text_cells(15, 4, ' ' * (TEXT_COLUMNS - 15), 0x17)
+    expected += text_cells(0, 9, 'A' * TEXT_COLUMNS, 0x07) + text_cells(0, 10, 'next', 0x07)
+    expected += text_cells(39, 19, ' ' * (TEXT_COLUMNS - 39), 0x27)
+    for row in range(20, TEXT_ROWS):
+        expected += text_cells(0, row, ' ' * TEXT_COLUMNS, 0x27)
+    expected += text_cells(TEXT_COLUMNS - 1, TEXT_ROWS - 1, 'X', 0x07)
+    reply, expected_hash = run(expected)
+
+    if frame_hash != expected_hash:
+        raise AssertionError('terminal frame %s, expected %s' % (frame_hash.decode(), expected_hash.decode()))
+
+
+TESTS = [
+    test_trace_wrap_replay,
+    test_trace_wrap_dump,
+    test_log_error,
+    test_packet_too_long,
+    test_cursor_erase,
+    test_cursor_copy_text,
+    test_ansi_terminal,
+]
+
+
+def main():
+    global SIM
+    if len(sys.argv) > 1:
+        SIM = sys.argv[1]
+
+    failed = 0
+    for test in TESTS:
+        try:
+            test()
+            print('PASS %s' % test.__name__)
+        except (AssertionError, subprocess.TimeoutExpired) as error:
+            print('FAIL %s: %s' % (test.__name__, error))
+            failed += 1
+
+    print('%d of %d checks passed' % (len(TESTS) - failed, len(TESTS)))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
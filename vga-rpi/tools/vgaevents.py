@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+###############################################################################
+#
+# vgaevents.py
+#
+#   Convert an event trace dump of the VGA emulator to a Chrome trace,
+#   for viewing in chrome://tracing or https://ui.perfetto.dev
+#   The dump is the reply to the system queue events command, starting with
+#   the 'VGAE' header. Main loop events are on thread 1, interrupt
+#   handlers on thread 2.
+#
+#   usage: vgaevents.py events.bin trace.json
+#
+#   October 18, 2026
+#
+###############################################################################
+
+import json
+import struct
+import sys
+
+EVENT_MAGIC = 0x45414756
+EVENT_VERSION = 1
+PHASES = ('B', 'E', 'i')
+
+# Event IDs, same as event_id_t in include/event.h
+EVENT_COMMAND = 0
+EVENT_IDLE = 1
+EVENT_PACKET = 2
+EVENT_IRQ = 3
+EVENT_MAILBOX = 4
+
+IRQ_NAMES = {0: 'ARM timer', 1: 'system timer 1', 3: 'system timer 3', 29: 'aux UART'}
+
+
+def event_name(event_id, payload):
+    """Event name and arguments from its ID and payload."""
+    if event_id in (EVENT_COMMAND, EVENT_PACKET):
+        name = 'command' if event_id == EVENT_COMMAND else 'packet'
+        return '%s %d.%d' % (name, payload >> 6, payload & 0x3f), {'cmd': payload}
+    if event_id == EVENT_IDLE:
+        return 'idle', {}
+    if event_id == EVENT_IRQ:
+        return 'irq %s' % IRQ_NAMES.get(payload, payload), {'source': payload}
+    if event_id == EVENT_MAILBOX:
+        return 'mailbox', {'tag': '0x%04x' % payload}
+    return 'event %d' % event_id, {'payload': payload}
+
+
+def main():
+    if len(sys.argv) != 3:
+        print('usage: %s events.bin trace.json' % sys.argv[0], file=sys.stderr)
+        return 1
+
+    with open(sys.argv[1], 'rb') as dump_file:
+        dump = dump_file.read()
+
+    start = dump.find(struct.pack('<I', EVENT_MAGIC))
+    if start < 0 or len(dump) < start + 20:
+        print('%s: no event header' % sys.argv[1], file=sys.stderr)
+        return 1
+
+    version, count, dropped, ticks = struct.unpack_from('<IIII', dump, start + 4)
+    if version != EVENT_VERSION:
+        print('%s: event version %d not supported' % (sys.argv[1], version), file=sys.stderr)
+        return 1
+
+    if len(dump) < start + 20 + count * 8:
+        print('%s: truncated event dump' % sys.argv[1], file=sys.stderr)
+        return 1
+
+    words = struct.unpack_from('<%dI' % (count * 2), dump, start + 20)
+
+    trace_events = []
+    open_spans = {}         # (thread, ID) to begin count, ends without a begin are left out
+    first_time = None
+    time = 0
+    last_stamp = None
+
+    for i in range(count):
+        stamp, event = words[2 * i:2 * i + 2]
+        phase = (event >> 24) & 0xff
+        event_id = (event >> 16) & 0xff
+        payload = event & 0xffff
+
+        # time stamps are free running 32-bit counters
+        if last_stamp is None:
+            first_time = stamp
+        else:
+            time += (stamp - last_stamp) & 0xffffffff
+        last_stamp = stamp
+
+        thread = 2 if event_id == EVENT_IRQ else 1
+        key = (thread, event_id)
+
+        if phase == 1:
+            if not open_spans.get(key):
+                continue
+            open_spans[key] -= 1
+        elif phase == 0:
+            open_spans[key] = open_spans.get(key, 0) + 1
+
+        name, args = event_name(event_id, payload)
+        record = {'name': name, 'ph': PHASES[phase] if phase < len(PHASES) else 'i',
+                  'ts': time / ticks, 'pid': 1, 'tid': thread, 'args': args}
+        if record['ph'] == 'i':
+            record['s'] = 't'
+        trace_events.append(record)
+
+    trace = {'traceEvents': trace_events,
+             'displayTimeUnit': 'ns',
+             'otherData': {'dropped events': dropped,
+                           'first time stamp': first_time,
+                           'ticks per uSec': ticks}}
+
+    with open(sys.argv[2], 'w') as json_file:
+        json.dump(trace, json_file, indent=0)
+
+    print('%d events, %d dropped' % (len(trace_events), dropped))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
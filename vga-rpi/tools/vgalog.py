@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+###############################################################################
+#
+# vgalog.py
+#
+#   Format a binary log dump of the VGA emulator.
+#   The dump is the reply to the system queue log command, starting with
+#   the 'VGAL' header. Format strings and constant string arguments are
+#   read from the emulator's ELF file at the addresses recorded in the log.
+#
+#   usage: vgalog.py vga.elf log.bin
+#
+#   October 18, 2026
+#
+###############################################################################
+
+import re
+import struct
+import sys
+
+LOG_MAGIC = 0x4C414756
+LOG_VERSION = 1
+LOG_TYPES = ('ERR', 'INFO', 'VERBOSE')
+
+# printf conversions used by debug() messages
+CONVERSION = re.compile(r'%([-+ 0#]*)(\d*)(?:\.(\d+))?([diuxXcsp%])')
+
+
+class Elf:
+    """Read constant strings from an ELF file's allocated sections."""
+
+    def __init__(self, file_name):
+        with open(file_name, 'rb') as elf_file:
+            self.data = elf_file.read()
+
+        if self.data[:4] != b'\x7fELF':
+            raise ValueError('%s: not an ELF file' % file_name)
+
+        elf_class = self.data[4]
+        if elf_class == 1:
+            shoff, = struct.unpack_from('<I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2e)
+            section = '<IIIIIIIIII'
+        else:
+            shoff, = struct.unpack_from('<Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x3a)
+            section = '<IIQQQQIIQQ'
+
+        # (address, size, file offset) of sections with file contents
+        self.sections = []
+        for i in range(shnum):
+            fields = struct.unpack_from(section, self.data, shoff + i * shentsize)
+            sh_type, sh_flags, sh_addr, sh_offset, sh_size = fields[1:6]
+            if sh_type == 1 and sh_flags & 2 and sh_addr:     # SHT_PROGBITS, SHF_ALLOC
+                self.sections.append((sh_addr, sh_size, sh_offset))
+
+    def string(self, address):
+        for sh_addr, sh_size, sh_offset in self.sections:
+            if sh_addr <= address < sh_addr + sh_size:
+                start = sh_offset + address - sh_addr
+                end = self.data.index(b'\0', start)
+                return self.data[start:end].decode('latin-1')
+        return None
+
+
+def format_message(elf, format_string, args):
+    """printf() style formatting with 32-bit arguments."""
+    args = list(args)
+
+    def convert(match):
+        flags, width, precision, conversion = match.groups()
+        if conversion == '%':
+            return '%'
+        value = args.pop(0) if args else 0
+        if conversion == 's':
+            text = elf.string(value)
+            value = text if text is not None else '<0x%08x>' % value
+        elif conversion == 'c':
+            value = chr(value & 0xff)
+        elif conversion in 'di':
+            value = value - (1 << 32) if value & 0x80000000 else value
+        elif conversion == 'p':
+            conversion, value = 'x', value
+        spec = '%' + flags + width + ('.' + precision if precision else '') + conversion
+        return spec % value
+
+    return CONVERSION.sub(convert, format_string)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print('usage: %s vga.elf log.bin' % sys.argv[0], file=sys.stderr)
+        return 1
+
+    elf = Elf(sys.argv[1])
+
+    with open(sys.argv[2], 'rb') as log_file:
+        dump = log_file.read()
+
+    start = dump.find(struct.pack('<I', LOG_MAGIC))
+    if start < 0 or len(dump) < start + 16:
+        print('%s: no log header' % sys.argv[2], file=sys.stderr)
+        return 1
+
+    version, words, dropped = struct.unpack_from('<III', dump, start + 4)
+    if version != LOG_VERSION:
+        print('%s: log version %d not supported' % (sys.argv[2], version), file=sys.stderr)
+        return 1
+
+    if len(dump) < start + 16 + words * 4:
+        print('%s: truncated log' % sys.argv[2], file=sys.stderr)
+        return 1
+
+    ring = struct.unpack_from('<%dI' % words, dump, start + 16)
+
+    if dropped:
+        print('(%d older messages dropped)' % dropped)
+
+    i = 0
+    first_time = None
+    while i + 3 <= words:
+        header, time, format_address = ring[i:i + 3]
+        nargs = (header >> 8) & 0xff
+        msg_type = header & 0xff
+        args = ring[i + 3:i + 3 + nargs]
+        i += 3 + nargs
+
+        if first_time is None:
+            first_time = time
+
+        format_string = elf.string(format_address)
+        if format_string is None:
+            text = '<format 0x%08x> %s\n' % (format_address, ' '.join('%08x' % a for a in args))
+        else:
+            text = format_message(elf, format_string, args)
+
+        label = LOG_TYPES[msg_type] if msg_type < len(LOG_TYPES) else str(msg_type)
+        sys.stdout.write('%10u %-7s %s' % ((time - first_time) & 0xffffffff, label, text))
+        if not text.endswith('\n'):
+            sys.stdout.write('\n')
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+###############################################################################
+#
+# vgaprof.py
+#
+#   Print a flat profile from a profile dump of the VGA emulator.
+#   The dump is the reply to the system queue profile command's dump action,
+#   starting with the 'VGAP' header. Sample addresses are resolved to
+#   functions with the symbol table of the emulator's ELF file, with -a the
+#   sampled addresses of every function are listed as well.
+#
+#   usage: vgaprof.py [-a] vga.elf profile.bin
+#
+#   October 18, 2026
+#
+###############################################################################
+
+import bisect
+import struct
+import sys
+
+PROFILE_MAGIC = 0x50414756
+PROFILE_VERSION = 1
+
+
+def read_symbols(file_name):
+    """Sorted (address, name) list of the code symbols in an ELF file."""
+    with open(file_name, 'rb') as elf_file:
+        data = elf_file.read()
+
+    if data[:4] != b'\x7fELF':
+        raise ValueError('%s: not an ELF file' % file_name)
+
+    if data[4] == 1:
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x2e)
+        section, symbol, symbol_size = '<IIIIIIIIII', '<IIIBBH', 16
+    else:
+        shoff, = struct.unpack_from('<Q', data, 0x28)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x3a)
+        section, symbol, symbol_size = '<IIQQQQIIQQ', '<IBBHQQ', 24
+
+    sections = [struct.unpack_from(section, data, shoff + i * shentsize) for i in range(shnum)]
+
+    symbols = {}
+    for sh_name, sh_type, sh_flags, sh_addr, sh_offset, sh_size, sh_link, sh_info, sh_align, sh_entsize in sections:
+        if sh_type != 2:                                    # SHT_SYMTAB
+            continue
+        strings = sections[sh_link][4]
+        for offset in range(sh_offset, sh_offset + sh_size, symbol_size):
+            fields = struct.unpack_from(symbol, data, offset)
+            if data[4] == 1:
+                st_name, st_value, st_size, st_info, st_other, st_shndx = fields
+            else:
+                st_name, st_info, st_other, st_shndx, st_value, st_size = fields
+            # functions, and untyped labels of assembly code
+            if (st_info & 0xf) not in (0, 2) or st_shndx == 0 or st_shndx >= 0xff00:
+                continue
+            if not sections[st_shndx][2] & 4:              # SHF_EXECINSTR
+                continue
+            end = data.index(b'\0', strings + st_name)
+            name = data[strings + st_name:end].decode('latin-1')
+            # skip ARM mapping symbols $a, $d and $t
+            if not name or name.startswith('$'):
+                continue
+            symbols.setdefault(st_value & ~1, name)
+
+    return sorted(symbols.items())
+
+
+def main():
+    args = sys.argv[1:]
+    addresses = '-a' in args
+    if addresses:
+        args.remove('-a')
+
+    if len(args) != 2:
+        print('usage: %s [-a] vga.elf profile.bin' % sys.argv[0], file=sys.stderr)
+        return 1
+
+    symbols = read_symbols(args[0])
+    symbol_addresses = [address for address, name in symbols]
+
+    with open(args[1], 'rb') as dump_file:
+        dump = dump_file.read()
+
+    start = dump.find(struct.pack('<I', PROFILE_MAGIC))
+    if start < 0 or len(dump) < start + 28:
+        print('%s: no profile header' % args[1], file=sys.stderr)
+        return 1
+
+    version, interval, bucket_size, samples, outside, records = struct.unpack_from('<IIIIII', dump, start + 4)
+    if version != PROFILE_VERSION:
+        print('%s: profile version %d not supported' % (args[1], version), file=sys.stderr)
+        return 1
+
+    if len(dump) < start + 28 + records * 8:
+        print('%s: truncated profile' % args[1], file=sys.stderr)
+        return 1
+
+    buckets = struct.unpack_from('<%dI' % (records * 2), dump, start + 28)
+
+    functions = {}
+    for i in range(records):
+        address, count = buckets[2 * i:2 * i + 2]
+        index = bisect.bisect_right(symbol_addresses, address) - 1
+        name = symbols[index][1] if index >= 0 else '0x%08x' % address
+        total, lines = functions.get(name, (0, []))
+        functions[name] = (total + count, lines + [(address, count)])
+
+    print('%d samples every %d uSec, %d outside of the code, %d byte buckets' %
+          (samples, interval, outside, bucket_size))
+    print('  samples      %  function')
+
+    for name, (total, lines) in sorted(functions.items(), key=lambda item: -item[1][0]):
+        print('%9d %6.2f  %s' % (total, 100.0 * total / samples if samples else 0.0, name))
+        if addresses:
+            for address, count in lines:
+                print('%9d         0x%08x' % (count, address))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,708 @@
+/********************************************************************
+ * trace.c
+ *
+ *  Command stream capture, replay and command cost statistics.
+ *
+ *  The capture records the raw UART receive byte stream, before
+ *  SLIP decoding, into a RAM ring, and optionally a time stamp at the
+ *  end of every packet. The capture starts at the first packet delimiter
+ *  after the start command. Received bytes are staged until their packet
+ *  is complete and then moved to the ring, except trace command packets,
+ *  which are left out of the capture. The ring is dumped through the UART, and
+ *  the dumped stream can be replayed on the RPi or with the host
+ *  simulation. Every dispatched command adds its processing time and
+ *  PMU counts (cycles and the two events selected in config.h) to
+ *  the statistics of its command type, which are reported at the
+ *  end of a replay or by request. Each command type also keeps a log2
+ *  histogram of its processing time, sent in binary with the statistics
+ *  query command.
+ *
+ *  Trace dump format, all values are 32-bit little endian:
+ *      magic 'VGAT', version, stream byte count N, time stamp count M,
+ *      N stream bytes,
+ *      M x {stream byte offset of the packet end, System Timer uSec}
+ *
+ *  Statistics query reply format, all values are 32-bit little endian:
+ *      magic 'VGAS', version, record count R, uSec from the start of the first
+ *      to the end of the last command,
+ *      R x {command byte, count, total uSec, max uSec, cycles low, cycles high,
+ *           event 0, event 1, first bucket F, bucket count B, B x bucket count}
+ *      bucket 0 counts commands of 0 uSec, bucket n>0 of 2^(n-1) to 2^n-1 uSec
+ *
+ *  Interrupt statistics query reply format, all values are 32-bit little endian:
+ *      magic 'VGAI', version, cycles per uSec, longest critical section cycles,
+ *      return address of its enable() call, handler count H,
+ *      H x {interrupt source, count, dispatch latency min, avg, max cycles,
+ *           handler run time min, avg, max cycles}
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#include    <stdint.h>
+
+#include    "timer.h"
+#include    "irq.h"
+#include    "pmu.h"
+#include    "printf.h"
+
+#include    "config.h"
+#include    "util.h"
+#include    "fb.h"
+#include    "uart.h"
+#include    "trace.h"
+
+/********************************************************************
+ * Definitions
+ *
+ */
+#define     TRACE_RING_BYTES    65536       // must be a power of 2
+#define     TRACE_RING_STAMPS   4096        // must be a power of 2
+#define     TRACE_PACKET_BYTES  2048        // staged packet, parameters and UART_DATA_MAX data bytes, SLIP escaped
+#define     TRACE_CMD_TYPES     256         // statistics per command byte
+#define     TRACE_HIST_BUCKETS  24          // log2 uSec histogram, last bucket holds 4.2 sec and longer
+
+#define     TRACE_SLIP_END      0xC0
+
+#define     TRACE_ACTION        (cmd_param->b1)
+#define     TRACE_FLAGS         (cmd_param->b2)
+
+typedef struct
+{
+    uint32_t    offset;             // stream byte count at the packet end
+    uint32_t    time;               // System Timer at the packet end
+} trace_stamp_t;
+
+typedef struct
+{
+    uint32_t    count;
+    uint32_t    total_time;
+    uint32_t    max_time;
+    uint64_t    cycles;             // PMU cycle counter
+    uint32_t    count0;             // PMU event counter 0
+    uint32_t    count1;             // PMU event counter 1
+    uint32_t    histogram[TRACE_HIST_BUCKETS];
+} trace_cmd_stat_t;
+
+/********************************************************************
+ * Static function prototypes
+ *
+ */
+static void trace_commit(void);
+static int  trace_linearize(void);
+static void trace_reverse(int, int);
+static void trace_clear_stats(void);
+static uint32_t trace_irq_clock(void);
+
+/********************************************************************
+ * Module globals (static)
+ *
+ */
+static int              capture_on = 0;
+static int              capture_sync = 0;   // waiting for a packet delimiter to start recording
+static int              capture_stamps = 0;
+static uint8_t          ring[TRACE_RING_BYTES];
+static uint32_t         ring_count = 0;     // bytes recorded since the capture started
+static uint8_t          packet[TRACE_PACKET_BYTES];
+static int              packet_bytes = 0;   // staged bytes of the current packet
+static int              packet_done = 0;    // staged packet is complete
+static uint32_t         packet_time;        // System Timer at the staged packet's end
+static trace_stamp_t    stamps[TRACE_RING_STAMPS];
+static uint32_t         stamp_count = 0;
+static uint8_t          last_byte = TRACE_SLIP_END;
+
+static trace_cmd_stat_t cmd_stats[TRACE_CMD_TYPES];
+static uint32_t         stats_first = 0;    // System Timer at the start of the first command
+static uint32_t         stats_last = 0;     // and at the end of the last command
+static uint32_t         stats_count = 0;
+static uint32_t         cmd_start_time;
+static pmu_sample_t     cmd_start_sample;
+static int              replay_done = 0;
+static int              irq_stats_on = 0;   // interrupt statistics were started
+
+/*------------------------------------------------
+ * trace_control()
+ *
+ *  System queue trace command.
+ *
+ * param:  command parameters, b1 is the action, b2 holds flags for TRACE_START
+ * return: none
+ *
+ */
+void trace_control(cmd_param_t *cmd_param)
+{
+    int         length, i;
+    uint32_t    stamp, first_stamp;
+
+    switch ( TRACE_ACTION )
+    {
+        case TRACE_STOP:
+            capture_on = 0;
+            trace_commit();
+            break;
+
+        case TRACE_START:
+            ring_count = 0;
+            stamp_count = 0;
+            packet_bytes = 0;
+            packet_done = 0;
+            last_byte = TRACE_SLIP_END;
+            capture_stamps = (TRACE_FLAGS & TRACE_FLAG_STAMPS);
+            capture_sync = 1;
+            capture_on = 1;
+            break;
+
+        case TRACE_DUMP:
+            capture_on = 0;
+            trace_commit();
+            length = trace_linearize();
+
+            // time stamps of packets that are still in the ring
+            first_stamp = (stamp_count > TRACE_RING_STAMPS) ? (stamp_count - TRACE_RING_STAMPS) : 0;
+            while ( first_stamp < stamp_count && stamps[first_stamp & (TRACE_RING_STAMPS - 1)].offset == 0 )
+                first_stamp++;
+
+            uart_send_word(TRACE_MAGIC);
+            uart_send_word(TRACE_VERSION);
+            uart_send_word(length);
+            uart_send_word(stamp_count - first_stamp);
+
+            for ( i = 0; i < length; i++ )
+                uart_send(ring[i]);
+
+            for ( stamp = first_stamp; stamp < stamp_count; stamp++ )
+            {
+                uart_send_word(stamps[stamp & (TRACE_RING_STAMPS - 1)].offset);
+                uart_send_word(stamps[stamp & (TRACE_RING_STAMPS - 1)].time);
+            }
+            break;
+
+        case TRACE_REPLAY:
+            capture_on = 0;
+            trace_commit();
+            length = trace_linearize();
+            trace_replay(ring, length);
+            break;
+
+        case TRACE_REPORT:
+            trace_report();
+            trace_clear_stats();
+            break;
+
+        default:
+            debug(DB_ERR, "%s: invalid trace action %d\n", __FUNCTION__, TRACE_ACTION);
+    }
+}
+
+/*------------------------------------------------
+ * trace_rx_byte()
+ *
+ *  Record a received byte when the capture is on.
+ *  The byte is staged with the rest of its packet, a complete packet
+ *  is moved to the ring when the next byte arrives, unless trace_packet()
+ *  dropped it in the meantime.
+ *
+ * param:  byte
+ * return: none
+ *
+ */
+void trace_rx_byte(uint8_t byte)
+{
+    if ( !capture_on )
+        return;
+
+    if ( capture_sync )
+    {
+        if ( byte != TRACE_SLIP_END )
+            return;
+        capture_sync = 0;
+    }
+
+    if ( packet_done || packet_bytes == TRACE_PACKET_BYTES )
+        trace_commit();
+
+    packet[packet_bytes++] = byte;
+
+    if ( byte == TRACE_SLIP_END && last_byte != TRACE_SLIP_END )
+    {
+        packet_done = 1;
+        packet_time = bcm2835_st_read();
+    }
+
+    last_byte = byte;
+}
+
+/*------------------------------------------------
+ * trace_packet()
+ *
+ *  Called by the UART module when a received packet is complete.
+ *  A staged trace command packet is dropped, so that replaying
+ *  the capture does not issue trace commands.
+ *
+ * param:  command byte of the packet
+ * return: none
+ *
+ */
+void trace_packet(int cmd)
+{
+    if ( !capture_on || !packet_done || cmd != UART_CMD_TRACE )
+        return;
+
+    packet_bytes = 0;
+    packet_done = 0;
+}
+
+/*------------------------------------------------
+ * trace_commit()
+ *
+ *  Move the staged packet bytes to the ring, and record the
+ *  packet's time stamp if it is complete. Bytes of an incomplete
+ *  packet are only moved when the staging buffer is full.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void trace_commit(void)
+{
+    int     i;
+
+    if ( !packet_done && packet_bytes < TRACE_PACKET_BYTES )
+    {
+        // the capture stopped in the middle of a packet
+        if ( !capture_on )
+            packet_bytes = 0;
+        return;
+    }
+
+    for ( i = 0; i < packet_bytes; i++ )
+    {
+        ring[ring_count & (TRACE_RING_BYTES - 1)] = packet[i];
+        ring_count++;
+    }
+
+    if ( packet_done && capture_stamps )
+    {
+        stamps[stamp_count & (TRACE_RING_STAMPS - 1)].offset = ring_count;
+        stamps[stamp_count & (TRACE_RING_STAMPS - 1)].time = packet_time;
+        stamp_count++;
+    }
+
+    packet_bytes = 0;
+    packet_done = 0;
+}
+
+/*------------------------------------------------
+ * trace_cmd_start()
+ *
+ *  Call when a command starts, for its processing time statistics.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void trace_cmd_start(void)
+{
+    cmd_start_time = bcm2835_st_read();
+    pmu_sample(&cmd_start_sample);
+}
+
+/*------------------------------------------------
+ * trace_cmd()
+ *
+ *  Add a command's processing time and PMU counts
+ *  to the statistics of its type.
+ *  Call when the command is done.
+ *
+ * param:  command byte
+ * return: none
+ *
+ */
+void trace_cmd(int cmd)
+{
+    uint32_t    end_time, elapsed;
+    int         bucket;
+
+    pmu_sample_delta(&cmd_start_sample);
+    end_time = bcm2835_st_read();
+    elapsed = end_time - cmd_start_time;
+
+    if ( stats_count == 0 )
+        stats_first = cmd_start_time;
+    stats_last = end_time;
+    stats_count++;
+
+    cmd &= (TRACE_CMD_TYPES - 1);
+    cmd_stats[cmd].count++;
+    cmd_stats[cmd].total_time += elapsed;
+    if ( elapsed > cmd_stats[cmd].max_time )
+        cmd_stats[cmd].max_time = elapsed;
+
+    bucket = (elapsed == 0) ? 0 : (32 - __builtin_clz(elapsed));
+    if ( bucket >= TRACE_HIST_BUCKETS )
+        bucket = TRACE_HIST_BUCKETS - 1;
+    cmd_stats[cmd].histogram[bucket]++;
+
+    cmd_stats[cmd].cycles += cmd_start_sample.cycles;
+    cmd_stats[cmd].count0 += cmd_start_sample.count0;
+    cmd_stats[cmd].count1 += cmd_start_sample.count1;
+}
+
+/*------------------------------------------------
+ * trace_replay()
+ *
+ *  Clear the command statistics and replay a byte stream
+ *  through the UART command decoder.
+ *
+ * param:  byte stream and its length
+ * return: none
+ *
+ */
+void trace_replay(uint8_t *stream, int length)
+{
+    trace_clear_stats();
+    uart_replay(stream, length);
+}
+
+/*------------------------------------------------
+ * trace_replay_done()
+ *
+ *  Called by the UART module when the replayed stream is consumed.
+ *  Commands of the last packet may still be in the command queue,
+ *  so the report is printed by trace_idle().
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void trace_replay_done(void)
+{
+    replay_done = 1;
+}
+
+/*------------------------------------------------
+ * trace_idle()
+ *
+ *  Call when there are no commands to process.
+ *  Prints the statistics when a replay is done.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void trace_idle(void)
+{
+    if ( replay_done )
+    {
+        replay_done = 0;
+        trace_report();
+    }
+}
+
+/*------------------------------------------------
+ * trace_get_totals()
+ *
+ *  Get the number of commands and the time from the start of
+ *  the first to the end of the last, since the statistics were cleared.
+ *
+ * param:  pointers to command count and time in uSec
+ * return: none
+ *
+ */
+void trace_get_totals(uint32_t *commands, uint32_t *time)
+{
+    *commands = stats_count;
+    *time = stats_last - stats_first;
+}
+
+/*------------------------------------------------
+ * trace_rate()
+ *
+ *  Commands per second.
+ *
+ * param:  command count, time in uSec
+ * return: commands per second, 0 if time is 0
+ *
+ */
+uint32_t trace_rate(uint32_t commands, uint32_t time)
+{
+    if ( time == 0 )
+        return 0;
+
+    return (uint32_t)(((uint64_t)commands * 1000000) / time);
+}
+
+/*------------------------------------------------
+ * trace_report()
+ *
+ *  Print the command statistics and the displayed frame's hash.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void trace_report(void)
+{
+    int         cmd;
+    uint32_t    elapsed;
+
+    elapsed = stats_last - stats_first;
+
+    printf("trace: %u commands in %u uSec, %u commands/sec, frame hash %08x\n",
+           stats_count, elapsed, trace_rate(stats_count, elapsed), fb_frame_hash());
+
+    for ( cmd = 0; cmd < TRACE_CMD_TYPES; cmd++ )
+    {
+        if ( cmd_stats[cmd].count == 0 )
+            continue;
+
+        printf("  queue %d cmd %2d: count %7u  total %9u  avg %6u  max %6u uSec  avg cycles %8u  ev0 %6u  ev1 %6u\n",
+               cmd >> 6, cmd & 0x3f,
+               cmd_stats[cmd].count,
+               cmd_stats[cmd].total_time,
+               cmd_stats[cmd].total_time / cmd_stats[cmd].count,
+               cmd_stats[cmd].max_time,
+               (uint32_t)(cmd_stats[cmd].cycles / cmd_stats[cmd].count),
+               cmd_stats[cmd].count0 / cmd_stats[cmd].count,
+               cmd_stats[cmd].count1 / cmd_stats[cmd].count);
+    }
+}
+
+/*------------------------------------------------
+ * trace_stats_send()
+ *
+ *  Send the command statistics and histograms in binary,
+ *  and clear them.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void trace_stats_send(void)
+{
+    int         cmd, records, first, last, bucket;
+
+    records = 0;
+    for ( cmd = 0; cmd < TRACE_CMD_TYPES; cmd++ )
+    {
+        if ( cmd_stats[cmd].count )
+            records++;
+    }
+
+    uart_send_word(TRACE_STATS_MAGIC);
+    uart_send_word(TRACE_VERSION);
+    uart_send_word(records);
+    uart_send_word(stats_last - stats_first);
+
+    for ( cmd = 0; cmd < TRACE_CMD_TYPES; cmd++ )
+    {
+        if ( cmd_stats[cmd].count == 0 )
+            continue;
+
+        // only the range of used buckets
+        for ( first = 0; cmd_stats[cmd].histogram[first] == 0; first++ );
+        for ( last = TRACE_HIST_BUCKETS - 1; cmd_stats[cmd].histogram[last] == 0; last-- );
+
+        uart_send_word(cmd);
+        uart_send_word(cmd_stats[cmd].count);
+        uart_send_word(cmd_stats[cmd].total_time);
+        uart_send_word(cmd_stats[cmd].max_time);
+        uart_send_word((uint32_t)cmd_stats[cmd].cycles);
+        uart_send_word((uint32_t)(cmd_stats[cmd].cycles >> 32));
+        uart_send_word(cmd_stats[cmd].count0);
+        uart_send_word(cmd_stats[cmd].count1);
+        uart_send_word(first);
+        uart_send_word(last - first + 1);
+        for ( bucket = first; bucket <= last; bucket++ )
+            uart_send_word(cmd_stats[cmd].histogram[bucket]);
+    }
+
+    trace_clear_stats();
+}
+
+/*------------------------------------------------
+ * trace_linearize()
+ *
+ *  Rotate the ring so the oldest byte is at the start, and skip
+ *  the partial packet at the start of a wrapped ring. Time stamp offsets
+ *  are moved to the new start, and stamps of dropped packets are set to 0.
+ *  The capture must be stopped.
+ *
+ * param:  none
+ * return: number of bytes, starting at ring[0]
+ *
+ */
+static int trace_linearize(void)
+{
+    int         start, length, skip, i;
+    uint32_t    base, stamp;
+
+    if ( ring_count <= TRACE_RING_BYTES )
+        return (int)ring_count;
+
+    start = ring_count & (TRACE_RING_BYTES - 1);
+
+    // rotate left by 'start' with three reversals
+    trace_reverse(0, start - 1);
+    trace_reverse(start, TRACE_RING_BYTES - 1);
+    trace_reverse(0, TRACE_RING_BYTES - 1);
+
+    // start at the first packet delimiter
+    for ( skip = 0; skip < TRACE_RING_BYTES && ring[skip] != TRACE_SLIP_END; skip++ );
+
+    length = TRACE_RING_BYTES - skip;
+    for ( i = 0; i < length; i++ )
+        ring[i] = ring[i + skip];
+
+    // the ring now holds the last 'length' bytes of the capture
+    base = ring_count - length;
+    ring_count = length;
+
+    stamp = (stamp_count > TRACE_RING_STAMPS) ? (stamp_count - TRACE_RING_STAMPS) : 0;
+    for ( ; stamp < stamp_count; stamp++ )
+    {
+        if ( stamps[stamp & (TRACE_RING_STAMPS - 1)].offset > base )
+            stamps[stamp & (TRACE_RING_STAMPS - 1)].offset -= base;
+        else
+            stamps[stamp & (TRACE_RING_STAMPS - 1)].offset = 0;
+    }
+
+    return length;
+}
+
+/*------------------------------------------------
+ * trace_reverse()
+ *
+ *  Reverse a range of ring bytes.
+ *
+ * param:  first and last index
+ * return: none
+ *
+ */
+static void trace_reverse(int first, int last)
+{
+    uint8_t     temp;
+
+    while ( first < last )
+    {
+        temp = ring[first];
+        ring[first] = ring[last];
+        ring[last] = temp;
+        first++;
+        last--;
+    }
+}
+
+/*------------------------------------------------
+ * trace_irq_start()
+ *
+ *  Clear and start the interrupt statistics,
+ *  timed with the PMU cycle counter.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void trace_irq_start(void)
+{
+    irq_stats_start(trace_irq_clock);
+    irq_stats_on = 1;
+}
+
+/*------------------------------------------------
+ * trace_irq_send()
+ *
+ *  Send the interrupt statistics in binary, and restart them
+ *  if they were started.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void trace_irq_send(void)
+{
+    int         handler, handlers;
+    uint32_t    section_max, section_pc, count;
+    irq_stats_t stats;
+
+    for ( handlers = 0; irq_stats_get(handlers, &stats); handlers++ );
+
+    irq_stats_masked(&section_max, &section_pc);
+
+    uart_send_word(TRACE_IRQ_MAGIC);
+    uart_send_word(TRACE_VERSION);
+    uart_send_word(VGA_CPU_MHZ);
+    uart_send_word(section_max);
+    uart_send_word(section_pc);
+    uart_send_word(handlers);
+
+    for ( handler = 0; handler < handlers; handler++ )
+    {
+        irq_stats_get(handler, &stats);
+
+        // minimums of a handler that was not called are 0xffffffff
+        count = stats.count;
+        if ( count == 0 )
+        {
+            stats.latency_min = 0;
+            stats.service_min = 0;
+            count = 1;
+        }
+
+        uart_send_word(stats.source);
+        uart_send_word(stats.count);
+        uart_send_word(stats.latency_min);
+        uart_send_word((uint32_t)(stats.latency_total / count));
+        uart_send_word(stats.latency_max);
+        uart_send_word(stats.service_min);
+        uart_send_word((uint32_t)(stats.service_total / count));
+        uart_send_word(stats.service_max);
+    }
+
+    if ( irq_stats_on )
+        trace_irq_start();
+}
+
+/*------------------------------------------------
+ * trace_clear_stats()
+ *
+ *  Clear the command statistics.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void trace_clear_stats(void)
+{
+    int         cmd, bucket;
+
+    for ( cmd = 0; cmd < TRACE_CMD_TYPES; cmd++ )
+    {
+        cmd_stats[cmd].count = 0;
+        cmd_stats[cmd].total_time = 0;
+        cmd_stats[cmd].max_time = 0;
+        cmd_stats[cmd].cycles = 0;
+        cmd_stats[cmd].count0 = 0;
+        cmd_stats[cmd].count1 = 0;
+        for ( bucket = 0; bucket < TRACE_HIST_BUCKETS; bucket++ )
+            cmd_stats[cmd].histogram[bucket] = 0;
+    }
+
+    stats_count = 0;
+    stats_first = 0;
+    stats_last = 0;
+}
+
+/*------------------------------------------------
+ * trace_irq_clock()
+ *
+ *  Interrupt statistics time base.
+ *
+ * param:  none
+ * return: PMU cycle counter
+ *
+ */
+static uint32_t trace_irq_clock(void)
+{
+    return pmu_read(PMU_CYCLE_COUNTER);
+}
@@ -19,8 +19,12 @@
 #include    "config.h"
 #include    "uart.h"
 #include    "util.h"
+#include    "trace.h"
+#include    "event.h"
+#include    "workload.h"
 
 #define     UART_CMD_Q_LEN      10
+#define     UART_CMD_PARAMS     ((int)(sizeof(cmd_param_t)/sizeof(int)))
 
 #define     SLIP_END            0xC0        // start and end of every packet
 #define     SLIP_ESC            0xDB        // escape start (one byte escaped data follows)
@@ -38,34 +42,15 @@
  */
 static  int         uart_module_initialized = 0;
 
-#if UART_TEST_CMD == 0
+static  uint8_t    *replay_stream = 0;      // replayed byte stream, read instead of the UART
+static  int         replay_length = 0;
+static  int         replay_position = 0;
 
 static  cmd_q_t     command_queue[UART_CMD_Q_LEN];
 static  int         cmd_in = 0;
 static  int         cmd_out = 0;
 static  int         cmd_count = 0;
 
-#else
-
-/********************************************************************
- *     Pre-fill test commands
- */
-
-static  cmd_q_t     command_queue[UART_CMD_Q_LEN] =
-{
-    {0,  {0,9, 0,0,0,0,0}},
-    {0,  {3,1,10,0,0,0,0}},
-    {0,  {4,0,65,0,0,0,7}}
-};
-
-static  int         cmd_in = 0;
-static  int         cmd_out = 0;
-static  int         cmd_count = 3;
-
-/********************************************************************/
-
-#endif
-
 /********************************************************************
  * uart_init()
  *
@@ -148,9 +133,11 @@ int uart_recv_cmd(void)
 
     static uint8_t  c;
 
-    static int      cmd[(sizeof(cmd_param_t)/sizeof(int))] = {0};
+    static int      cmd[UART_CMD_PARAMS] = {0};
+    static uint8_t  data[UART_DATA_MAX];
     static int      slip_esc_received = 0;
     static int      count = 0;
+    static int      data_count = 0;
     static int      done_cmd_packet = 0;
 
     if ( !uart_module_initialized )
@@ -166,7 +153,33 @@ int uart_recv_cmd(void)
 
     while ( 1 )
     {
-        read_result = bcm2835_auxuart_rx_byte(&c);
+        if ( replay_stream )
+        {
+            read_result = 0;
+            if ( replay_position < replay_length )
+            {
+                c = replay_stream[replay_position++];
+                read_result = 1;
+            }
+            else
+            {
+                replay_stream = 0;
+                trace_replay_done();
+            }
+        }
+#if UART_TEST_CMD
+        // the UART is not read while the workload generator runs
+        else if ( workload_active() )
+        {
+            read_result = 0;
+        }
+#endif
+        else
+        {
+            read_result = bcm2835_auxuart_rx_byte(&c);
+            if ( read_result == 1 )
+                trace_rx_byte(c);
+        }
 
 /*
         if ( read_result == 1 )
@@ -205,6 +218,7 @@ int uart_recv_cmd(void)
             else
             {
                 done_cmd_packet = 1;
+                data_count = (count > UART_CMD_PARAMS) ? (count - UART_CMD_PARAMS) : 0;
                 count = 0;
                 break;
             }
@@ -215,15 +229,20 @@ int uart_recv_cmd(void)
             slip_esc_received = 1;
             continue;
         }
-        // handle full packet with no delimiter
-        else if ( count == (sizeof(cmd_param_t)/sizeof(int)) )
+
+        // handle full packet with no delimiter, also after an escaped byte
+        if ( count >= (UART_CMD_PARAMS + UART_DATA_MAX) )
         {
             debug(DB_ERR, "%s: invalid command frame; discarding\n", __FUNCTION__);
             count = 0;
             break;
         }
 
-        cmd[count] = c;
+        // command and parameter bytes, then optional data bytes
+        if ( count < UART_CMD_PARAMS )
+            cmd[count] = c;
+        else
+            data[count - UART_CMD_PARAMS] = c;
         count++;
     }
 
@@ -236,6 +255,10 @@ int uart_recv_cmd(void)
     {
         done_cmd_packet = 0;
 
+        // trace captures leave out their own control commands
+        if ( !replay_stream )
+            trace_packet(cmd[0]);
+
         // check if there is room in the queue for this command
         if ( cmd_count == UART_CMD_Q_LEN )
         {
@@ -248,8 +271,11 @@ int uart_recv_cmd(void)
         commands = 1;
         command_queue[cmd_in].queue = (int)(((uint32_t)cmd[0] >> 6) & 0x03);
         memcpy(&command_queue[cmd_in].cmd_param, &cmd, sizeof(cmd_param_t));
+        command_queue[cmd_in].data_count = data_count;
+        if ( data_count )
+            memcpy(command_queue[cmd_in].data, data, data_count);
 
-        debug(DB_VERBOSE, "uart_recv_cmd(): [%d] %3d | %3d %3d %3d %3d %3d %3d\n",
+        debug(DB_VERBOSE, "uart_recv_cmd(): [%d] %3d | %3d %3d %3d %3d %3d %3d | +%d\n",
                           command_queue[cmd_in].queue,
                           command_queue[cmd_in].cmd_param.cmd,
                           command_queue[cmd_in].cmd_param.b1,
@@ -257,7 +283,10 @@ int uart_recv_cmd(void)
                           command_queue[cmd_in].cmd_param.b3,
                           command_queue[cmd_in].cmd_param.b4,
                           command_queue[cmd_in].cmd_param.b5,
-                          command_queue[cmd_in].cmd_param.b6);
+                          command_queue[cmd_in].cmd_param.b6,
+                          command_queue[cmd_in].data_count);
+
+        event_instant(EVENT_PACKET, cmd[0]);
 
         memset(&cmd, 0, sizeof(cmd_param_t));
         cmd_count++;
@@ -289,6 +318,22 @@ void uart_send(uint8_t byte)
     bcm2835_auxuart_putchr(byte);
 }
 
+/********************************************************************
+ * uart_send_word()
+ *
+ *  Send a 32-bit word to host PC/XT, little endian.
+ *
+ *  param:  word to send
+ *  return: none
+ */
+void uart_send_word(uint32_t word)
+{
+    uart_send((uint8_t)word);
+    uart_send((uint8_t)(word >> 8));
+    uart_send((uint8_t)(word >> 16));
+    uart_send((uint8_t)(word >> 24));
+}
+
 /********************************************************************
  * uart_rts_active()
  *
@@ -323,3 +368,36 @@ void uart_rts_not_active(void)
         bcm2835_gpio_set(UART_RTS);
     }
 }
+
+/********************************************************************
+ * uart_replay()
+ *
+ *  Replay a received byte stream.
+ *  The stream's bytes are processed instead of the UART's until
+ *  the stream is consumed, UART bytes that arrive in the meantime
+ *  wait in the UART receive buffer.
+ *
+ *  param:  byte stream and its length
+ *  return: none
+ *
+ */
+void uart_replay(uint8_t *stream, int length)
+{
+    replay_stream = stream;
+    replay_length = length;
+    replay_position = 0;
+}
+
+/********************************************************************
+ * uart_replay_active()
+ *
+ *  Check if a replayed stream is being processed.
+ *
+ *  param:  none
+ *  return: 1 if the replay is not done, 0 if done
+ *
+ */
+int uart_replay_active(void)
+{
+    return (replay_stream != 0);
+}
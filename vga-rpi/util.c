@@ -10,7 +10,9 @@
 //#include    <stdio.h>
 //#include    <stdlib.h>
 #include    <stdarg.h>
+#include    <stdint.h>
 
+#include    "timer.h"
 #include    "printf.h"
 
 #include    "config.h"
@@ -21,11 +23,18 @@
  * Definitions
  *
  */
+#define     LOG_RING_WORDS      4096                // must be a power of 2
+#define     LOG_ENTRY_WORDS     3                   // header, time stamp, and format, then the arguments
+#define     LOG_ENTRY_TYPE(h)   ((h) & 0xff)
+#define     LOG_ENTRY_ARGS(h)   (((h) >> 8) & 0xff)
 
 /********************************************************************
  * Static function prototypes
  *
  */
+#if UTIL_LOG_IDLE_DRAIN
+static void log_print(void);
+#endif
 
 /********************************************************************
  * Module globals (static)
@@ -33,13 +42,19 @@
  */
 static  int debug_level = UTIL_DEF_DBG_LVL;
 
+static  uint32_t    log_ring[LOG_RING_WORDS];
+static  uint32_t    log_in = 0;             // free running word indexes
+static  uint32_t    log_out = 0;
+static  uint32_t    log_dropped = 0;        // messages dropped since the last log_send()
+
 /********************************************************************
  * debug_lvl()
  *
- *  Set global debug level
+ *  Set global debug level, messages below the level are recorded
  *  0 no output
  *  1 errors only
  *  2 errors and info
+ *  3 errors, info and verbose
  *
  *  param:  debug level
  *  return: none
@@ -50,40 +65,89 @@ void debug_lvl(int level)
 }
 
 /********************************************************************
- * debug()
+ * log_write()
  *
- *  Print debug messages
+ *  Record a debug message in the log ring, called through the
+ *  debug() macro. The format string is not parsed, the arguments are
+ *  copied as 32-bit words. When the ring is full the oldest messages
+ *  are dropped.
  *
- *  param:  debug type, printf-style debug string and parameters
- *  return: number of characters printed
- *          -1 fail
+ *  param:  debug type, printf-style debug string, argument count, and arguments
+ *  return: none
  */
-int debug(int type, char *format, ...)
+void log_write(int type, const char *format, int nargs, ...)
 {
-    va_list aptr;
-    int     ret;
+    va_list     aptr;
+    int         i;
+    uint32_t    words;
 
-    if ( debug_level == 0 )
-    {
-        return 0;
-    }
-    else if ( debug_level == 1 && (type == DB_INFO || type == DB_VERBOSE) )
-    {
-        return 0;
-    }
-    else if ( debug_level == 2 && type == DB_VERBOSE )
+    if ( type >= debug_level )
+        return;
+
+    if ( nargs > LOG_MAX_ARGS )
+        nargs = LOG_MAX_ARGS;
+
+    words = LOG_ENTRY_WORDS + nargs;
+
+    while ( (LOG_RING_WORDS - (log_in - log_out)) < words )
     {
-        return 0;
+        log_out += LOG_ENTRY_WORDS + LOG_ENTRY_ARGS(log_ring[log_out & (LOG_RING_WORDS - 1)]);
+        log_dropped++;
     }
 
-    if ( type == DB_ERR )
-        printf("ERR: ");
+    log_ring[log_in++ & (LOG_RING_WORDS - 1)] = (nargs << 8) | type;
+    log_ring[log_in++ & (LOG_RING_WORDS - 1)] = bcm2835_st_read();
+    log_ring[log_in++ & (LOG_RING_WORDS - 1)] = (uint32_t)(uintptr_t)format;
 
-    va_start(aptr, format);
-    ret = vprintf(format, aptr);
+    va_start(aptr, nargs);
+    for ( i = 0; i < nargs; i++ )
+        log_ring[log_in++ & (LOG_RING_WORDS - 1)] = va_arg(aptr, uint32_t);
     va_end(aptr);
+}
 
-    return(ret);
+/********************************************************************
+ * log_idle()
+ *
+ *  Call when there are no commands to process.
+ *  Prints the oldest log message if idle time draining is configured.
+ *
+ *  param:  none
+ *  return: none
+ */
+void log_idle(void)
+{
+#if UTIL_LOG_IDLE_DRAIN
+    if ( log_in != log_out )
+        log_print();
+#endif
+}
+
+/********************************************************************
+ * log_send()
+ *
+ *  Send the log ring in binary and clear it.
+ *  Format, all values are 32-bit little endian:
+ *      magic 'VGAL', version, word count N, dropped message count,
+ *      N words of messages {type | argument count << 8}{System Timer uSec}
+ *      {format string address}{arguments}
+ *
+ *  param:  none
+ *  return: none
+ */
+void log_send(void)
+{
+    uart_send_word(LOG_MAGIC);
+    uart_send_word(LOG_VERSION);
+    uart_send_word(log_in - log_out);
+    uart_send_word(log_dropped);
+
+    while ( log_out != log_in )
+    {
+        uart_send_word(log_ring[log_out & (LOG_RING_WORDS - 1)]);
+        log_out++;
+    }
+
+    log_dropped = 0;
 }
 
 /********************************************************************
@@ -136,3 +200,34 @@ void _putchar(char character)
         bcm2835_auxuart_putchr('\r');
     bcm2835_auxuart_putchr(character);
 }
+
+#if UTIL_LOG_IDLE_DRAIN
+/*------------------------------------------------
+ * log_print()
+ *
+ *  Print and remove the oldest log message.
+ *
+ *  param:  none
+ *  return: none
+ */
+static void log_print(void)
+{
+    uint32_t    header, args[LOG_MAX_ARGS];
+    char       *format;
+    int         i;
+
+    header = log_ring[log_out++ & (LOG_RING_WORDS - 1)];
+    log_out++;                                  // time stamp is not printed
+    format = (char*)(uintptr_t)log_ring[log_out++ & (LOG_RING_WORDS - 1)];
+
+    for ( i = 0; i < LOG_MAX_ARGS; i++ )
+        args[i] = (i < LOG_ENTRY_ARGS(header)) ? log_ring[log_out++ & (LOG_RING_WORDS - 1)] : 0;
+
+    if ( LOG_ENTRY_TYPE(header) == DB_ERR )
+        printf("ERR: ");
+
+    printf(format, (uintptr_t)args[0], (uintptr_t)args[1], (uintptr_t)args[2], (uintptr_t)args[3],
+                   (uintptr_t)args[4], (uintptr_t)args[5], (uintptr_t)args[6], (uintptr_t)args[7],
+                   (uintptr_t)args[8], (uintptr_t)args[9]);
+}
+#endif
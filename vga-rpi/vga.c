@@ -11,9 +11,17 @@
 
 #include    <stdint.h>
 
+#include    "pmu.h"
+
 #include    "config.h"
 #include    "util.h"
 #include    "fb.h"
+#include    "ansi.h"
+#include    "trace.h"
+#include    "event.h"
+#include    "profile.h"
+#include    "monitor.h"
+#include    "workload.h"
 #include    "uart.h"
 
 /********************************************************************
@@ -32,19 +40,33 @@ cmd_q_t* command_q = 0;
  */
 void kernel(uint32_t r0, uint32_t machid, uint32_t atags)
 {
-    /* TODO Set debug level
-     */
-    debug_lvl(0);
+    int     idle = 0;
 
     /* Start emulation loop
      */
+    event_init();
     uart_init();
     debug(DB_VERBOSE, "Starting VGA emulator.\n");
 
+    profile_init();
+
+    pmu_init(VGA_PMU_EVENT0, VGA_PMU_EVENT1);
+    pmu_start();
+
+#if VGA_IRQ_STATS
+    trace_irq_start();
+#endif
+
     if ( fb_init(VGA_DEF_MODE) == 0 )
     {
         uart_rts_active();      // this signals a ready state to the PCXT
 
+#if UART_TEST_CMD
+        workload_start();
+#endif
+
+        monitor_init();
+
         /* VGA card emulator processing loop
          */
         while (1)
@@ -53,16 +75,27 @@ void kernel(uint32_t r0, uint32_t machid, uint32_t atags)
 
             if ( command_q )
             {
+                if ( idle )
+                {
+                    event_end(EVENT_IDLE, 0);
+                    idle = 0;
+                }
+
+                monitor_begin();
+                event_begin(EVENT_COMMAND, command_q->cmd_param.cmd);
+                trace_cmd_start();
+
                 /* Handle VGA emulation
                  */
                 if ( command_q->queue == UART_Q_VGA )
                 {
-                    fb_emul(&(command_q->cmd_param));
+                    fb_emul(&(command_q->cmd_param), command_q->data, command_q->data_count);
                 }
-                /* Handle queue #1
+                /* Handle ANSI terminal emulation
                  */
                 else if ( command_q->queue == UART_Q_OTHER1 )
                 {
+                    ansi_emul(&(command_q->cmd_param), command_q->data, command_q->data_count);
                 }
                 /* Handle queue #2
                  */
@@ -78,17 +111,80 @@ void kernel(uint32_t r0, uint32_t machid, uint32_t atags)
                         debug(DB_INFO, "echo reply\n");
                         echo_reply();
                     }
+                    else if ( command_q->cmd_param.cmd == UART_CMD_TRACE )
+                    {
+                        trace_control(&(command_q->cmd_param));
+                    }
+                    else if ( command_q->cmd_param.cmd == UART_CMD_STATS )
+                    {
+                        trace_stats_send();
+                    }
+                    else if ( command_q->cmd_param.cmd == UART_CMD_LOG )
+                    {
+                        log_send();
+                    }
+                    else if ( command_q->cmd_param.cmd == UART_CMD_EVENTS )
+                    {
+                        event_send();
+                    }
+                    else if ( command_q->cmd_param.cmd == UART_CMD_PROFILE )
+                    {
+                        profile_control(&(command_q->cmd_param));
+                    }
+                    else if ( command_q->cmd_param.cmd == UART_CMD_IRQ_STATS )
+                    {
+                        trace_irq_send();
+                    }
+                    else if ( command_q->cmd_param.cmd == UART_CMD_MONITOR )
+                    {
+                        monitor_send();
+                    }
                 }
                 else if ( command_q->queue == UART_Q_ABRT )
                 {
                     debug(DB_ERR, "aborting test.\n");
                     break;
                 }
+
+                /* Processing time statistics of emulation commands
+                 */
+                if ( command_q->queue != UART_Q_SYSTEM )
+                    trace_cmd(command_q->cmd_param.cmd);
+
+                event_end(EVENT_COMMAND, command_q->cmd_param.cmd);
+                monitor_end(command_q->cmd_param.cmd);
+            }
+            else
+            {
+                /* One idle span until the next command,
+                 * not one per loop iteration
+                 */
+                if ( !idle )
+                {
+                    event_begin(EVENT_IDLE, 0);
+                    idle = 1;
+                }
+
+                /* Use idle time for deferred frame buffer work
+                 */
+                monitor_begin();
+                fb_idle();
+                trace_idle();
+                log_idle();
+                pmu_poll();
+#if UART_TEST_CMD
+                workload_idle();
+#endif
+                monitor_end(MONITOR_NO_CMD);
             }
 
             fb_cursor_blink();
 
             uart_recv_cmd();
+
+            /* Idle time of the rest of the iteration
+             */
+            monitor_loop();
         }
     }
     else
@@ -0,0 +1,336 @@
+/********************************************************************
+ * workload.c
+ *
+ *  Built-in synthetic workload generator.
+ *  Enabled with UART_TEST_CMD in config.h, for benchmarking the
+ *  emulator without a PC/XT attached.
+ *
+ *  The workload runs every test in every mode of the mode list.
+ *  Each step generates a SLIP framed command stream, same as the
+ *  PC/XT would send, and replays it through the UART command decoder
+ *  and the normal command dispatch. The trace module prints the
+ *  processing time statistics of every step, and a throughput
+ *  summary per mode is printed when the workload is done.
+ *  Generated commands use a fixed pseudo random sequence, so every
+ *  run produces the same command streams.
+ *
+ *  October 18, 2026
+ *
+ *******************************************************************/
+
+#include    <stdint.h>
+
+#include    "printf.h"
+
+#include    "config.h"
+#include    "util.h"
+#include    "fb.h"
+#include    "uart.h"
+#include    "trace.h"
+#include    "workload.h"
+
+/********************************************************************
+ * Definitions
+ *
+ */
+#define     WORKLOAD_STREAM     65536       // generated stream buffer bytes
+#define     WORKLOAD_PACKET_MAX 16          // longest generated packet, all bytes escaped plus two END
+
+#define     SLIP_END            0xC0
+#define     SLIP_ESC            0xDB
+#define     SLIP_ESC_END        0xDC
+#define     SLIP_ESC_ESC        0xDD
+
+typedef enum
+{
+    WL_PUT_CHARS,                           // random characters and attributes at random positions
+    WL_SCROLLS,                             // full screen scroll up by one row
+    WL_CLEARS,                              // clear screen
+    WL_PIXELS,                              // random pixels at random positions, graphics modes only
+    WL_MODE_SWITCH,                         // alternate between the tested mode and the default mode
+    WL_TESTS
+} workload_test_t;
+
+typedef struct
+{
+    const char *name;
+    int         divisor;                    // command count is WORKLOAD_COMMANDS / divisor
+    int         graphics_only;
+} workload_test_info_t;
+
+/********************************************************************
+ * Static function prototypes
+ *
+ */
+static int      workload_generate(int, workload_test_t);
+static void     workload_packet(int, int, int, int, int, int, int);
+static uint32_t workload_random(void);
+static void     workload_summary(void);
+
+/********************************************************************
+ * Module globals (static)
+ *
+ */
+static const workload_test_info_t workload_tests[WL_TESTS] =
+{
+    { "put chars",   1,   0 },
+    { "scrolls",     20,  0 },
+    { "clears",      20,  0 },
+    { "pixels",      1,   1 },
+    { "mode switch", 100, 0 },
+};
+
+static const int    workload_modes[] = { 1, 3, 4, 6, 7, 8, 9, 19 };
+
+#define     WORKLOAD_MODES      ((int)(sizeof(workload_modes)/sizeof(int)))
+
+static int          workload_on = 0;
+static int          workload_step = 0;      // mode index * WL_TESTS + test
+static uint32_t     random_state;
+
+static uint8_t      stream[WORKLOAD_STREAM];
+static int          stream_length = 0;
+
+static uint32_t     mode_commands[WORKLOAD_MODES];
+static uint32_t     mode_time[WORKLOAD_MODES];
+
+/*------------------------------------------------
+ * workload_start()
+ *
+ *  Start the workload with its first step.
+ *  UART receive is suspended until the workload is done.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void workload_start(void)
+{
+    int         i;
+
+    for ( i = 0; i < WORKLOAD_MODES; i++ )
+    {
+        mode_commands[i] = 0;
+        mode_time[i] = 0;
+    }
+
+    random_state = WORKLOAD_SEED;
+    workload_step = 0;
+    workload_on = 1;
+
+    printf("workload: %d modes, %d commands per test\n", WORKLOAD_MODES, WORKLOAD_COMMANDS);
+
+    workload_idle();
+}
+
+/*------------------------------------------------
+ * workload_active()
+ *
+ *  Check if the workload is running.
+ *
+ * param:  none
+ * return: 1 if running, 0 if done or not started
+ *
+ */
+int workload_active(void)
+{
+    return workload_on;
+}
+
+/*------------------------------------------------
+ * workload_idle()
+ *
+ *  Call when there are no commands to process, after trace_idle().
+ *  When the replay of a step is done, accounts for its processing time
+ *  and starts the next step.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+void workload_idle(void)
+{
+    int         mode_index, columns, rows, width, height;
+    uint32_t    commands, time;
+    workload_test_t test;
+
+    if ( !workload_on || uart_replay_active() )
+        return;
+
+    // account for the step that just finished
+    if ( stream_length )
+    {
+        trace_get_totals(&commands, &time);
+        mode_commands[(workload_step - 1) / WL_TESTS] += commands;
+        mode_time[(workload_step - 1) / WL_TESTS] += time;
+        stream_length = 0;
+    }
+
+    // find the next step that applies to its mode
+    while ( workload_step < (WORKLOAD_MODES * WL_TESTS) )
+    {
+        mode_index = workload_step / WL_TESTS;
+        test = (workload_test_t)(workload_step % WL_TESTS);
+        workload_step++;
+
+        if ( workload_tests[test].graphics_only &&
+             fb_get_mode_info(workload_modes[mode_index], &columns, &rows, &width, &height) != 1 )
+            continue;
+
+        stream_length = workload_generate(workload_modes[mode_index], test);
+
+        printf("workload: mode %d %s\n", workload_modes[mode_index], workload_tests[test].name);
+        trace_replay(stream, stream_length);
+        return;
+    }
+
+    workload_summary();
+    workload_on = 0;
+}
+
+/*------------------------------------------------
+ * workload_generate()
+ *
+ *  Generate the command stream of a test step.
+ *  The stream starts with a mode set, and stops short of
+ *  the command count if the stream buffer is full.
+ *
+ * param:  video mode, test
+ * return: stream length in bytes
+ *
+ */
+static int workload_generate(int mode, workload_test_t test)
+{
+    int         columns, rows, width, height;
+    int         count, i, c, x, y, attribute;
+
+    fb_get_mode_info(mode, &columns, &rows, &width, &height);
+
+    stream_length = 0;
+    workload_packet(UART_CMD_VID_MODE, mode, 0, 0, 0, 0, 0);
+
+    count = WORKLOAD_COMMANDS / workload_tests[test].divisor;
+
+    for ( i = 0; i < count && stream_length <= (WORKLOAD_STREAM - WORKLOAD_PACKET_MAX); i++ )
+    {
+        switch ( test )
+        {
+            case WL_PUT_CHARS:
+                c = workload_random() & 0xff;
+                x = workload_random() % columns;
+                y = workload_random() % rows;
+                attribute = workload_random() & 0xff;
+                workload_packet(UART_CMD_PUT_CHRA, 0, c, x, y, 0, attribute);
+                break;
+
+            case WL_SCROLLS:
+                workload_packet(UART_CMD_SCR_UP, 1, 0, 0, columns - 1, rows - 1, workload_random() & 0x7f);
+                break;
+
+            case WL_CLEARS:
+                workload_packet(UART_CMD_CLR_SCR, 0, 0, 0, 0, 0, workload_random() & 0x7f);
+                break;
+
+            case WL_PIXELS:
+                c = workload_random() & 0xff;
+                x = workload_random() % width;
+                y = workload_random() % height;
+                workload_packet(UART_CMD_PUT_PIX, 0, c, x & 0xff, x >> 8, y & 0xff, y >> 8);
+                break;
+
+            case WL_MODE_SWITCH:
+                workload_packet(UART_CMD_VID_MODE, (i & 1) ? mode : VGA_DEF_MODE, 0, 0, 0, 0, 0);
+                break;
+
+            default:;
+        }
+    }
+
+    return stream_length;
+}
+
+/*------------------------------------------------
+ * workload_packet()
+ *
+ *  Append a SLIP framed command packet to the stream.
+ *
+ * param:  command and six parameter bytes
+ * return: none
+ *
+ */
+static void workload_packet(int cmd, int b1, int b2, int b3, int b4, int b5, int b6)
+{
+    uint8_t     packet[7];
+    int         i;
+
+    packet[0] = cmd;
+    packet[1] = b1;
+    packet[2] = b2;
+    packet[3] = b3;
+    packet[4] = b4;
+    packet[5] = b5;
+    packet[6] = b6;
+
+    stream[stream_length++] = SLIP_END;
+
+    for ( i = 0; i < (int)sizeof(packet); i++ )
+    {
+        if ( packet[i] == SLIP_END )
+        {
+            stream[stream_length++] = SLIP_ESC;
+            stream[stream_length++] = SLIP_ESC_END;
+        }
+        else if ( packet[i] == SLIP_ESC )
+        {
+            stream[stream_length++] = SLIP_ESC;
+            stream[stream_length++] = SLIP_ESC_ESC;
+        }
+        else
+        {
+            stream[stream_length++] = packet[i];
+        }
+    }
+
+    stream[stream_length++] = SLIP_END;
+}
+
+/*------------------------------------------------
+ * workload_random()
+ *
+ *  xorshift32 pseudo random number generator.
+ *
+ * param:  none
+ * return: next number
+ *
+ */
+static uint32_t workload_random(void)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    return random_state;
+}
+
+/*------------------------------------------------
+ * workload_summary()
+ *
+ *  Print the command throughput of every mode.
+ *
+ * param:  none
+ * return: none
+ *
+ */
+static void workload_summary(void)
+{
+    int         i;
+
+    printf("workload: done\n");
+
+    for ( i = 0; i < WORKLOAD_MODES; i++ )
+    {
+        printf("  mode %2d: %7u commands  %9u uSec  %7u commands/sec\n",
+               workload_modes[i], mode_commands[i], mode_time[i],
+               trace_rate(mode_commands[i], mode_time[i]));
+    }
+}